@@ -23,6 +23,9 @@
 #include "epicsAssert.h"
 #include "epicsTime.h"
 #include "epicsTimer.h"
+#include "epicsMutex.h"
+#include "epicsEvent.h"
+#include "epicsThread.h"
 #include "iocsh.h"
 
 #include "asynDriver.h"
@@ -34,11 +37,26 @@
 #include "StreamBusInterface.h"
 #include "StreamError.h"
 #include "StreamBuffer.h"
+#include "StreamTimerWheel.h"
 #include "devStream.h"
 #include "MacroMagic.h"
 
 #define Z PRINTF_SIZE_T_PREFIX
 
+// Size of reads used to discard old input before writing.
+// 0: use pasynOctet->flush() (old input is not forwarded to async records)
+extern "C" {
+int streamDrainSize = 4096;
+epicsExportAddress(int, streamDrainSize);
+// Upper limit for adaptive read sizes when reply length is unknown.
+int streamReadSizeLimit = 65536;
+epicsExportAddress(int, streamReadSizeLimit);
+// Timeout in ms of the blocking read of one reader per port and address
+// for "I/O Intr" input. 0: every client polls periodically (PollPeriod).
+int streamIntrReader = 0;
+epicsExportAddress(int, streamIntrReader);
+}
+
 /* How things are implemented:
 
 synchonous io:
@@ -56,7 +74,8 @@ lockRequest()
 writeRequest()
     pasynManager->queueRequest()
     when request is handled
-        pasynOctet->flush()
+        pasynOctet->read() old input with timeout 0
+            in chunks of streamDrainSize bytes (GPIB: pasynOctet->flush())
         pasynOctet->write()
         if write() times out
             writeCallback(StreamIoTimeout)
@@ -72,7 +91,7 @@ writeRequest()
 readRequest()
     pasynManager->queueRequest()
     when request is handled
-        optionally: pasynOctet->setInputEos()
+        optionally: pasynOctet->setInputEos() (if EOS differs from cached)
         pasynOctet->read()
         if time out at the first byte
             readCallback(StreamIoNoReply)
@@ -92,17 +111,55 @@ readRequest()
 unlock()
     call pasynManager->unblockProcessCallback()
 
+writeRequest() and readRequest() called from a callback inside a handler
+(e.g. writeRequest() from lockCallback() or readRequest() from
+writeCallback()) do not queue again, because we are already in the port
+thread with exclusive access. handleRequest() runs the next handler in a
+loop after the current one has returned (no recursion).
+Thus a complete out/in transaction needs only one queueRequest().
+
 asynchonous input support ("I/O Intr"):
 
 pasynOctet->registerInterruptUser(...,intrCallbackOctet,...) is called
-initially. This calls intrCallbackOctet() every time input is received,
+once per port and address by AsynIntrDispatcher. This calls
+AsynIntrDispatcher::dispatch() every time input is received,
 but only if someone else is doing a read. Thus, if nobody reads
 something, arrange for periodical read polls.
+With streamIntrReader, the AsynIntrDispatcher queues a read request of
+its own instead, which blocks in pasynOctet->read() for up to
+streamIntrReader ms and queues again with low priority. Then the
+clients do not poll.
+dispatch() calls intrCallbackOctet() of all clients which may be
+interested in the input: Clients which wait for a new message get only
+input where a message starts with one of the literal prefixes of their
+'in' commands. Clients without such prefixes get all input.
+The input is framed once (asyn EOS restored or removed) and the same
+copy is passed to all clients.
+
+shared requests ("CoalesceTime"):
+
+coalesceRequest()
+    if the same output to the same port and address is already queued
+    by another client (the leader) within the given time window
+        do not lock, write or read
+        get copies of the leader's callbacks from AsynRequestCoalescer:
+        lockCallback() and writeCallback() when the leader has written
+        readCallback() with all input the leader receives
+    else
+        become leader of a new group for this output
 
 */
 
+class AsynIntrDispatcher;
+class AsynRequestCoalescer;
+class AsynEosCache;
+class AsynInputDrain;
+
 class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
 {
+    friend class AsynIntrDispatcher;
+    friend class AsynRequestCoalescer;
+
     ENUM (IoAction,
         None, Lock, Write, Read, AsyncRead, AsyncReadMore,
         ReceiveEvent, Connect, Disconnect);
@@ -136,7 +193,17 @@ class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
     void* pvtCommon;
     asynOctet* pasynOctet;
     void* pvtOctet;
-    void* intrPvtOctet;
+    AsynIntrDispatcher* dispatcher;
+    StreamBuffer indexedTerminator;
+    StreamBuffer indexedPrefixes;
+    unsigned long dispatchMark;
+    AsynRequestCoalescer* coalescer;
+    AsynDriverInterface* coalesceNext;
+    bool following;         // request is shared with a leader
+    bool coalesceWritten;   // got lockCallback() and writeCallback()
+    bool coalesceReading;   // wants more input
+    size_t coalesceOffset;  // input already passed on
+    unsigned long coalesceReads;
     asynInt32* pasynInt32;
     void* pvtInt32;
     void* intrPvtInt32;
@@ -160,7 +227,18 @@ class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
     size_t peeksize;
     epicsTimerQueueActive* timerQueue;
     epicsTimer* timer;
+    StreamPortTimer* portTimer;   // instead of timer (streamTimerWheel)
     asynStatus previousAsynStatus;
+    epicsThreadId handlerThread;  // port thread while in handleRequest()
+    bool requestPending;          // next ioAction for handleRequest() loop
+    AsynEosCache* eosCache;
+    AsynInputDrain* drain;
+    enum { ReplySizeHistory = 32 };
+    size_t replySizes[ReplySizeHistory];  // recent replies (ring buffer)
+    unsigned int replySizeCount;
+    size_t readSize;    // 95th percentile of replySizes
+    double pollDelay;   // current poll period (0: not yet polled)
+    double pollDelayMax; // back off up to this (PollPeriodMax)
 
     AsynDriverInterface(Client* client);
     ~AsynDriverInterface();
@@ -172,12 +250,15 @@ class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
         unsigned long writeTimeout_ms);
     bool readRequest(unsigned long replyTimeout_ms,
         unsigned long readTimeout_ms, ssize_t expectedLength, bool async);
+    bool coalesceRequest(const void* output, size_t size,
+        unsigned long window_ms);
     bool acceptEvent(unsigned long mask, unsigned long replytimeout_ms);
     bool supportsEvent();
     bool supportsAsyncRead();
     bool connectRequest(unsigned long connecttimeout_ms);
     bool disconnectRequest();
     void finish();
+    void printStatus(StreamBuffer& buffer);
 
     // epicsTimerNotify methods
     epicsTimerNotify::expireStatus expire(const epicsTime &);
@@ -192,19 +273,40 @@ class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
     void disconnectHandler();
     bool connectToAsynPort();
     void asynReadHandler(const char *data, size_t numchars, int eomReason);
+
+    // client callbacks, passed on to clients sharing our request
+    void lockCallback(StreamIoStatus status = StreamIoSuccess);
+    void writeCallback(StreamIoStatus status = StreamIoSuccess);
+    ssize_t readCallback(StreamIoStatus status,
+        const void* input = NULL, size_t size = 0);
+
     asynQueuePriority priority() {
         return static_cast<asynQueuePriority>
             (StreamBusInterface::priority());
     }
     void startTimer(double timeout) {
-        timer->start(*this, timeout
+        if (portTimer) {
+            portTimer->start(timeout);
+            return;
+        }
+        if (timer) timer->start(*this, timeout
             +epicsThreadSleepQuantum()*0.5
         );
     }
     void cancelTimer() {
-        timer->cancel();
+        if (portTimer) portTimer->cancel();
+        else if (timer) timer->cancel();
     }
     void reportAsynStatus(asynStatus status, const char *name);
+    void drainInput();
+    void recordReplySize(size_t size);
+    double nextPoll();
+
+    // EOS access through the cache shared by the port/addr
+    asynStatus getInputEos(char* eos, int size, int* len);
+    asynStatus setInputEos(const char* eos, int len);
+    asynStatus getOutputEos(char* eos, int size, int* len);
+    asynStatus setOutputEos(const char* eos, int len);
 
     // asynUser callback functions (need some static wrappers here)
     void handleRequest();
@@ -217,11 +319,7 @@ class AsynDriverInterface : StreamBusInterface, epicsTimerNotify
         static_cast<AsynDriverInterface*>(pasynUser->userPvt)->handleTimeout();
     }
 
-    void intrCallbackOctet(char *data, size_t numchars, int eomReason);
-    static void intrCallbackOctet(void *pvt, asynUser *pasynUser,
-        char *data, size_t numchars, int eomReason) {
-        static_cast<AsynDriverInterface*>(pasynUser->userPvt)->intrCallbackOctet(data, numchars, eomReason);
-    }
+    void intrCallbackOctet(const char *data, size_t numchars, int eomReason);
 
     void intrCallbackInt32(epicsInt32 data);
     static void intrCallbackInt32(void *pvt, asynUser *pasynUser,
@@ -247,13 +345,251 @@ public:
 
 RegisterStreamBusInterface(AsynDriverInterface);
 
+// Port-level dispatcher for asynchronous input ("I/O Intr").
+// All clients on the same port and address share one interrupt user.
+// Clients are indexed in a tree by the literal prefixes of their 'in'
+// commands, one tree per input terminator. Input is passed only to
+// clients with a prefix that matches the start of a message in the
+// input, so that not every client has to parse every message.
+// Clients without known prefixes, clients in the middle of a message
+// and clients not waiting for input get all input as before.
+
+class AsynIntrDispatcher : epicsTimerNotify
+{
+    struct Entry
+    {
+        AsynDriverInterface* interface;
+        Entry* next;
+    };
+
+    struct Node
+    {
+        Node* sibling;
+        Node* children;
+        Entry* entries;
+        unsigned char byte;
+        Node(unsigned char byte = 0) :
+            sibling(NULL), children(NULL), entries(NULL), byte(byte) {}
+    };
+
+    struct Index
+    {
+        Index* next;
+        StreamBuffer terminator;
+        StreamBuffer tail;  // end of previous input for split terminators
+        bool atStart;       // previous input ended with a terminator
+        Node root;
+        Index() : next(NULL), atStart(true) {}
+    };
+
+    static epicsMutex lock;
+    static AsynIntrDispatcher* first;
+
+    AsynIntrDispatcher* next;
+    StreamBuffer portname;
+    int addr;
+    asynUser* pasynUser;
+    asynOctet* pasynOctet;
+    void* pvtOctet;
+    void* intrPvtOctet;
+    AsynEosCache* eosCache;
+    Entry* entries;     // all clients in order of attachment
+    Index* indexes;
+    unsigned long serial;
+    int busy;
+    epicsEvent idle;
+    asynUser* readerUser;   // blocking reader (streamIntrReader)
+    double readerTimeout;
+    bool readerQueued;
+    bool readerStopping;
+    epicsMutex readerLock;
+    epicsTimerQueueActive* readerTimerQueue;
+    epicsTimer* readerTimer;    // retry after read errors
+    char readerBuffer[4096];
+
+    AsynIntrDispatcher(const char* portname, int addr);
+    ~AsynIntrDispatcher();
+    bool connect();
+    bool connectReader();
+    void queueReader();
+    void readHandler();
+    static void readHandler(asynUser *pasynUser) {
+        static_cast<AsynIntrDispatcher*>(pasynUser->userPvt)->readHandler();
+    }
+    static void readerException(asynUser *pasynUser,
+        asynException exception);
+    expireStatus expire(const epicsTime&) {
+        queueReader();
+        return noRestart;
+    }
+    void insert(AsynDriverInterface* interface,
+        const char* terminator, size_t termlen,
+        const char* prefixes, size_t prefixlen);
+    void remove(AsynDriverInterface* interface);
+    static void remove(Node* node, AsynDriverInterface* interface);
+    static void freeNodes(Node* node);
+    void markCandidates(Index* index, const char* data, size_t numchars,
+        int eomReason);
+    void match(Node* node, const char* data, size_t numchars);
+    void markAll(Node* node);
+    void mark(Entry* entry) {
+        for (; entry; entry = entry->next)
+            entry->interface->dispatchMark = serial;
+    }
+    void dispatch(char *data, size_t numchars, int eomReason);
+    static void intrCallbackOctet(void *pvt, asynUser *pasynUser,
+        char *data, size_t numchars, int eomReason) {
+        static_cast<AsynIntrDispatcher*>(pasynUser->userPvt)->dispatch(data, numchars, eomReason);
+    }
+
+public:
+    static bool attach(AsynDriverInterface* interface);
+    static void detach(AsynDriverInterface* interface);
+    bool reading() const { return readerUser != NULL; }
+};
+
+epicsMutex AsynIntrDispatcher::lock;
+AsynIntrDispatcher* AsynIntrDispatcher::first = NULL;
+
+// Group of clients sending the same output to the same port and address.
+// Only the leader really locks, writes and reads. The followers get the
+// leader's writeCallback() and all input the leader receives. All
+// callbacks to followers run in the context of the leader's callbacks.
+// The group is closed when the leader unlocks, finishes or writes again.
+// Followers which have not been served until then get an error.
+
+class AsynRequestCoalescer
+{
+    friend class AsynDriverInterface;
+
+    static epicsMutex lock;
+    static AsynRequestCoalescer* first;
+
+    AsynRequestCoalescer* next;
+    StreamBuffer portname;
+    int addr;
+    StreamBuffer output;
+    StreamBuffer terminator;
+    epicsTimeStamp started;
+    AsynDriverInterface* leader;
+    AsynDriverInterface* followers;
+    StreamIoStatus lockStatus;
+    StreamIoStatus writeStatus;
+    bool written;
+    StreamBuffer reply;
+    StreamIoStatus replyStatus;
+    unsigned long reads;
+
+    AsynRequestCoalescer(AsynDriverInterface* leader,
+        const char* portname, int addr,
+        const void* output, size_t size,
+        const char* terminator, size_t termlen);
+    void wrote(StreamIoStatus status);
+    void received(StreamIoStatus status, const void* input, size_t size);
+    void update();
+    void close();
+
+public:
+    static bool join(AsynDriverInterface* interface,
+        const void* output, size_t size, unsigned long window_ms);
+    static void leave(AsynDriverInterface* interface);
+    static bool reading(AsynDriverInterface* interface);
+};
+
+epicsMutex AsynRequestCoalescer::lock;
+AsynRequestCoalescer* AsynRequestCoalescer::first = NULL;
+
+// Input and output EOS currently installed in the port/addr, shared
+// by all clients of the same port and address.
+// With interposed EOS layers, getting and setting the EOS are calls
+// through locks into the driver. Thus call the driver only if the
+// EOS has to change.
+// The EOS may be changed on connect or by other asyn users, thus forget
+// everything on any exception and whenever a client locks the port.
+// Within one locked protocol, only the first read and write ask the driver.
+
+class AsynEosCache
+{
+public:
+    struct Eos
+    {
+        bool valid;
+        asynStatus status;  // result of getInputEos()/getOutputEos()
+        int len;
+        char eos[16];
+        Eos() : valid(false), status(asynSuccess), len(0) {}
+    };
+
+    typedef asynStatus (*GetEos)(void*, asynUser*, char*, int, int*);
+    typedef asynStatus (*SetEos)(void*, asynUser*, const char*, int);
+
+    Eos input;
+    Eos output;
+
+    static AsynEosCache* attach(const char* portname, int addr);
+    static void detach(AsynEosCache* cache);
+    asynStatus get(Eos& cached, GetEos getEos, void* pvt,
+        asynUser* pasynUser, char* eos, int size, int* len);
+    asynStatus set(Eos& cached, SetEos setEos, void* pvt,
+        asynUser* pasynUser, const char* eos, int len);
+    void invalidate();
+
+private:
+    static epicsMutex listLock;
+    static AsynEosCache* first;
+
+    AsynEosCache* next;
+    StreamBuffer portname;
+    int addr;
+    int refcount;
+    epicsMutex lock;
+
+    AsynEosCache(const char* portname, int addr) :
+        next(NULL), portname(portname), addr(addr), refcount(0) {}
+};
+
+epicsMutex AsynEosCache::listLock;
+AsynEosCache* AsynEosCache::first = NULL;
+
+// Buffer for old input discarded before writing, shared by all clients
+// of the same port and address. Only used in the port thread.
+
+class AsynInputDrain
+{
+public:
+    StreamBuffer buffer;
+    unsigned long drained;  // bytes discarded so far
+
+    static AsynInputDrain* attach(const char* portname, int addr);
+    static void detach(AsynInputDrain* drain);
+
+private:
+    static epicsMutex listLock;
+    static AsynInputDrain* first;
+
+    AsynInputDrain* next;
+    StreamBuffer portname;
+    int addr;
+    int refcount;
+
+    AsynInputDrain(const char* portname, int addr) :
+        drained(0), next(NULL), portname(portname), addr(addr), refcount(0) {}
+};
+
+epicsMutex AsynInputDrain::listLock;
+AsynInputDrain* AsynInputDrain::first = NULL;
+
 AsynDriverInterface::
 AsynDriverInterface(Client* client) : StreamBusInterface(client)
 {
     debug ("AsynDriverInterface(%s)\n", client->name());
     pasynCommon = NULL;
     pasynOctet = NULL;
-    intrPvtOctet = NULL;
+    dispatcher = NULL;
+    dispatchMark = 0;
+    coalescer = NULL;
+    coalesceNext = NULL;
+    following = false;
     pasynInt32 = NULL;
     intrPvtInt32 = NULL;
     pasynUInt32 = NULL;
@@ -264,18 +600,23 @@ AsynDriverInterface(Client* client) : StreamBusInterface(client)
     receivedEvent = 0;
     peeksize = 1;
     previousAsynStatus = asynSuccess;
+    handlerThread = NULL;
+    requestPending = false;
+    eosCache = NULL;
+    drain = NULL;
+    replySizeCount = 0;
+    readSize = 0;
+    pollDelay = 0;
+    pollDelayMax = 0;
+    portTimer = NULL;
     debug ("AsynDriverInterface(%s) createAsynUser\n", client->name());
     pasynUser = pasynManager->createAsynUser(handleRequest,
         handleTimeout);
     assert(pasynUser);
     pasynUser->userPvt = this;
-    debug ("AsynDriverInterface(%s) epicsTimerQueueActive::allocate(true)\n",
-        client->name());
-    timerQueue = &epicsTimerQueueActive::allocate(true);
-    assert(timerQueue);
-    debug ("AsynDriverInterface(%s) timerQueue->createTimer()\n", client->name());
-    timer = &timerQueue->createTimer();
-    assert(timer);
+    // created in connectToBus unless the port timer is used
+    timerQueue = NULL;
+    timer = NULL;
     debug ("AsynDriverInterface(%s) done\n", client->name());
 }
 
@@ -284,6 +625,10 @@ AsynDriverInterface::
 {
     cancelTimer();
 
+    if (coalescer)
+    {
+        AsynRequestCoalescer::leave(this);
+    }
     if (intrPvtInt32)
     {
         // Int32 event interface is connected
@@ -300,18 +645,26 @@ AsynDriverInterface::
     {
         // octet stream interface is connected
         int wasQueued;
-        if (intrPvtOctet)
+        if (dispatcher)
         {
-            pasynOctet->cancelInterruptUser(pvtOctet,
-                pasynUser, intrPvtOctet);
+            AsynIntrDispatcher::detach(this);
         }
         pasynManager->cancelRequest(pasynUser, &wasQueued);
         // does not return until running handler has finished
     }
     // Now, no handler is running any more and none will start.
 
-    timer->destroy();
-    timerQueue->release();
+    if (eosCache)
+    {
+        AsynEosCache::detach(eosCache);
+    }
+    if (drain)
+    {
+        AsynInputDrain::detach(drain);
+    }
+    delete portTimer;
+    if (timer) timer->destroy();
+    if (timerQueue) timerQueue->release();
     pasynManager->disconnect(pasynUser);
     pasynManager->freeAsynUser(pasynUser);
     pasynUser = NULL;
@@ -388,17 +741,9 @@ supportsEvent()
 bool AsynDriverInterface::
 supportsAsyncRead()
 {
-    if (intrPvtOctet) return true;
-
     // hook "I/O Intr" support
-    if (pasynOctet->registerInterruptUser(pvtOctet, pasynUser,
-        intrCallbackOctet, this, &intrPvtOctet) != asynSuccess)
-    {
-        error("%s: asyn port %s does not support asynchronous input: %s\n",
-            clientName(), name(), pasynUser->errorMessage);
-        return false;
-    }
-    return true;
+    // (called again whenever the asynchronous protocol restarts)
+    return AsynIntrDispatcher::attach(this);
 }
 
 bool AsynDriverInterface::
@@ -440,6 +785,26 @@ connectToBus(const char* portname, int addr)
     }
     pasynOctet = static_cast<asynOctet*>(pasynInterface->pinterface);
     pvtOctet = pasynInterface->drvPvt;
+    eosCache = AsynEosCache::attach(portname, addr);
+    drain = AsynInputDrain::attach(portname, addr);
+    if (streamTimerWheel)
+    {
+        portTimer = new StreamPortTimer(portname, *this);
+        if (!portTimer->valid())
+        {
+            delete portTimer;
+            portTimer = NULL;
+        }
+    }
+    if (!portTimer)
+    {
+        debug ("AsynDriverInterface(%s) epicsTimerQueueActive::allocate(true)\n",
+            clientName());
+        timerQueue = &epicsTimerQueueActive::allocate(true);
+        assert(timerQueue);
+        timer = &timerQueue->createTimer();
+        assert(timer);
+    }
 
     // Check if device knows EOS
     size_t streameoslen = 0;
@@ -447,8 +812,8 @@ connectToBus(const char* portname, int addr)
     {
         char asyneos[16];
         int eoslen;
-        asynStatus status = pasynOctet->getInputEos(pvtOctet,
-            pasynUser, asyneos, sizeof(asyneos)-1, &eoslen);
+        asynStatus status = getInputEos(
+            asyneos, sizeof(asyneos)-1, &eoslen);
         if (status != asynSuccess)
         {
             error("%s: warning: No input EOS support.\n",
@@ -531,6 +896,7 @@ connectToAsynPort()
     if (!connected)
     {
         status = pasynCommon->connect(pvtCommon, pasynUser);
+        eosCache->invalidate();
         reportAsynStatus(status, "connectToAsynPort");
         if (status != asynSuccess) return false;
         connected = true;
@@ -555,6 +921,9 @@ lockHandler()
         lockCallback(StreamIoFault);
         return;
     }
+    // Other asyn users (e.g. asynRecord IEOS/OEOS or asynOctetSetInputEos)
+    // may have changed the EOS since the last lock.
+    eosCache->invalidate();
     lockCallback();
 }
 
@@ -566,6 +935,18 @@ unlock()
 
     debug("AsynDriverInterface::unlock(%s)\n",
         clientName());
+    if (following)
+    {
+        // we never had the bus, the leader had it for us
+        AsynRequestCoalescer::leave(this);
+        following = false;
+        return true;
+    }
+    if (coalescer)
+    {
+        // no more followers for our request
+        AsynRequestCoalescer::leave(this);
+    }
     status = pasynManager->unblockProcessCallback(pasynUser, false);
     if (status != asynSuccess)
     {
@@ -585,11 +966,29 @@ writeRequest(const void* output, size_t size,
         clientName(), StreamBuffer(output, size).expand()(),
         writeTimeout_ms);
 
+    if (following)
+    {
+        // the leader writes for us
+        return true;
+    }
+    if (coalescer && coalescer->written)
+    {
+        // new output: reply is not what followers have asked for
+        AsynRequestCoalescer::leave(this);
+    }
+
     asynStatus status;
     outputBuffer = (char*)output;
     outputSize = size;
     writeTimeout = writeTimeout_ms*0.001;
     ioAction = Write;
+    if (handlerThread == epicsThreadGetIdSelf())
+    {
+        // we have exclusive access already:
+        // handleRequest() continues with writeHandler()
+        requestPending = true;
+        return true;
+    }
     status = pasynManager->queueRequest(pasynUser, priority(),
         writeTimeout);
     reportAsynStatus(status, "writeRequest");
@@ -599,45 +998,61 @@ writeRequest(const void* output, size_t size,
     // or handleTimeout() -> writeCallback(StreamIoTimeout)
 }
 
-// now, we can write (called by asynManager)
 void AsynDriverInterface::
-writeHandler()
+drainInput()
 {
-    debug("AsynDriverInterface::writeHandler(%s)\n",
-        clientName());
     asynStatus status;
-    size_t written = 0;
+    // may be changed from the shell at any time
+    int drainSize = streamDrainSize;
 
-    pasynUser->timeout = 0;
-    if (!pasynGpib)
+    if (pasynGpib || drainSize <= 0)
     {
-        // discard any early input, but forward it to potential async records
-        // thus do not use pasynOctet->flush()
-        // unfortunately we cannot do this with GPIB because addressing a
+        // Unfortunately we cannot read with GPIB because addressing a
         // device as talker when it has nothing to say is an error.
         // Also timeout=0 does not help here (would need a change in asynGPIB),
         // thus use flush() for GPIB.
-        do {
-            char buffer [256];
-            size_t received = 0;
-            int eomReason = 0;
-            debug("AsynDriverInterface::writeHandler(%s): reading old input\n",
-                clientName());
-            status = pasynOctet->read(pvtOctet, pasynUser,
-                buffer, sizeof(buffer), &received, &eomReason);
-            if (status == asynError || received == 0) break;
-            if (received) debug("AsynDriverInterface::writeHandler(%s): "
-                "flushing %" Z "u bytes: \"%s\"\n",
-                clientName(), received, StreamBuffer(buffer, received).expand()());
-        } while (status == asynSuccess);
-    }
-    else
-    {
-        debug("AsynDriverInterface::writeHandler(%s): flushing old input\n",
+        debug("AsynDriverInterface::drainInput(%s): flushing old input\n",
             clientName());
-         pasynOctet->flush(pvtOctet, pasynUser);
+        pasynOctet->flush(pvtOctet, pasynUser);
+        return;
     }
 
+    // Discard any early input, but forward it to potential async records,
+    // thus do not use pasynOctet->flush().
+    // Read everything at once (the driver passes it to the interrupt
+    // users in one call) and repeat only if the buffer was filled or
+    // an EOS layer has split the input.
+    char* buffer = drain->buffer.clear().reserve(drainSize);
+    size_t received;
+    int eomReason;
+    do {
+        received = 0;
+        eomReason = 0;
+        debug("AsynDriverInterface::drainInput(%s): reading old input\n",
+            clientName());
+        status = pasynOctet->read(pvtOctet, pasynUser,
+            buffer, drainSize, &received, &eomReason);
+        if (status == asynError || received == 0) break;
+        drain->drained += received;
+        debug("AsynDriverInterface::drainInput(%s): "
+            "flushing %" Z "u bytes: \"%s\"\n",
+            clientName(), received, StreamBuffer(buffer, received).expand()());
+    } while (status == asynSuccess &&
+        ((int)received == drainSize || (eomReason & ASYN_EOM_EOS)));
+}
+
+// now, we can write (called by asynManager)
+void AsynDriverInterface::
+writeHandler()
+{
+    debug("AsynDriverInterface::writeHandler(%s)\n",
+        clientName());
+    asynStatus status;
+    size_t written = 0;
+
+    pasynUser->timeout = 0;
+    drainInput();
+
     // discard any early events
     receivedEvent = 0;
 
@@ -653,15 +1068,21 @@ writeHandler()
     if (streameos) // stream has already added eos, don't do it again in asyn
     {
         // clear terminator for asyn
-        status = pasynOctet->getOutputEos(pvtOctet,
-            pasynUser, oldeos, sizeof(oldeos)-1, &oldeoslen);
-        if (status != asynSuccess)
+        status = getOutputEos(oldeos, sizeof(oldeos)-1, &oldeoslen);
+        if (status == asynSuccess && oldeoslen == 0)
         {
+            // already empty: nothing to clear and restore
             oldeoslen = -1;
-            // No EOS support?
         }
-        pasynOctet->setOutputEos(pvtOctet, pasynUser,
-            NULL, 0);
+        else
+        {
+            if (status != asynSuccess)
+            {
+                oldeoslen = -1;
+                // No EOS support?
+            }
+            setOutputEos(NULL, 0);
+        }
     }
     int writeTry = 0;
     do {
@@ -686,8 +1107,7 @@ writeHandler()
 
     if (oldeoslen >= 0) // restore asyn terminator
     {
-        pasynOctet->setOutputEos(pvtOctet, pasynUser,
-            oldeos, oldeoslen);
+        setOutputEos(oldeos, oldeoslen);
     }
 
     switch (status)
@@ -765,6 +1185,12 @@ readRequest(unsigned long replyTimeout_ms, unsigned long readTimeout_ms,
         clientName(), replyTimeout_ms, readTimeout_ms,
         _expectedLength, async?"yes":"no");
 
+    if (following && AsynRequestCoalescer::reading(this))
+    {
+        // the leader reads for us
+        return true;
+    }
+
     asynStatus status;
     readTimeout = readTimeout_ms*0.001;
     replyTimeout = replyTimeout_ms*0.001;
@@ -774,6 +1200,15 @@ readRequest(unsigned long replyTimeout_ms, unsigned long readTimeout_ms,
     if (async)
     {
         ioAction = AsyncRead;
+        // input has just arrived or the protocol has (re-)started:
+        // poll fast again
+        pollDelay = 0;
+        pollDelayMax = getPollPeriodMax()*0.001;
+        if (dispatcher && dispatcher->reading())
+        {
+            // the reader of the dispatcher gets all input
+            return true;
+        }
         queueTimeout = -1.0;
         // First poll for input (no timeout),
         // later poll periodically if no other input arrives
@@ -782,6 +1217,13 @@ readRequest(unsigned long replyTimeout_ms, unsigned long readTimeout_ms,
     else {
         ioAction = Read;
         queueTimeout = replyTimeout;
+        if (handlerThread == epicsThreadGetIdSelf())
+        {
+            // we have exclusive access already:
+            // handleRequest() continues with readHandler()
+            requestPending = true;
+            return true;
+        }
     }
     status = pasynManager->queueRequest(pasynUser,
         priority(), queueTimeout);
@@ -800,7 +1242,7 @@ readRequest(unsigned long replyTimeout_ms, unsigned long readTimeout_ms,
         if (async)
         {
             // silently try again later
-            startTimer(replyTimeout);
+            startTimer(nextPoll());
             return true;
         }
         return false;
@@ -828,8 +1270,7 @@ readHandler()
     if (streameos) // streameos == NULL means: don't change eos
     {
         asynStatus status;
-        status = pasynOctet->getInputEos(pvtOctet,
-            pasynUser, oldeos, sizeof(oldeos)-1, &oldeoslen);
+        status = getInputEos(oldeos, sizeof(oldeos)-1, &oldeoslen);
         if (status != asynSuccess)
             oldeoslen = -1;
         else do {
@@ -839,8 +1280,7 @@ readHandler()
                 // nothing to do: old and new eos are the same
                 break;
             }
-            if (pasynOctet->setInputEos(pvtOctet, pasynUser,
-                deveos, (int)deveoslen) == asynSuccess)
+            if (setInputEos(deveos, (int)deveoslen) == asynSuccess)
             {
                 debug2("AsynDriverInterface::readHandler(%s) "
                     "input EOS changed from \"%s\" to \"%s\"\n",
@@ -872,7 +1312,9 @@ readHandler()
     }
     else
     {
+        // read what recent replies needed in one go
         buffersize = inputBuffer.capacity();
+        if (readSize > buffersize) buffersize = readSize;
     }
     char* buffer = inputBuffer.clear().reserve(buffersize);
 
@@ -889,6 +1331,7 @@ readHandler()
     }
     bool waitForReply = true;
     size_t received;
+    size_t replySize = 0;
     int eomReason;
     asynStatus status;
     ssize_t readMore;
@@ -976,6 +1419,7 @@ readHandler()
                     eomReason &= ~ASYN_EOM_EOS;
                 }
 
+                if ((ssize_t)received > 0) replySize += received;
                 readMore = readCallback(
                     eomReason & (ASYN_EOM_END|ASYN_EOM_EOS) ?
                     StreamIoEnd : StreamIoSuccess,
@@ -991,7 +1435,7 @@ readHandler()
                             "no async input, retry in in %g seconds\n",
                             clientName(), replyTimeout);
                         // start next poll after timer expires
-                        if (replyTimeout != 0.0) startTimer(replyTimeout);
+                        if (replyTimeout != 0.0) startTimer(nextPoll());
                         // continues with:
                         //    timerExpired() -> queueRequest() ->
                         //                 handleRequest() -> readHandler()
@@ -1084,12 +1528,14 @@ readHandler()
         waitForReply = false;
     }
 
+    if (replySize && expectedLength <= 0)
+        recordReplySize(replySize);
+
     // restore original EOS
     if (oldeoslen >= 0 && oldeoslen != (int)deveoslen &&
         strcmp(deveos, oldeos) != 0)
     {
-        pasynOctet->setInputEos(pvtOctet, pasynUser,
-            oldeos, oldeoslen);
+        setInputEos(oldeos, oldeoslen);
         debug2("AsynDriverInterface::readHandler(%s) "
             "input EOS restored from \"%s\" to \"%s\"\n",
             clientName(),
@@ -1099,147 +1545,914 @@ readHandler()
 }
 
 void AsynDriverInterface::
-intrCallbackOctet(char *data, size_t numchars, int eomReason)
+recordReplySize(size_t size)
 {
-// Problems here:
-// 1. We get this message too when we are the poller.
-//    Thus we have to ignore what we got from polling.
-// 2. eomReason=ASYN_EOM_CNT when message was too long for
-//    internal buffer of asynDriver.
+    size_t sorted[ReplySizeHistory];
+    unsigned int i, j, n;
 
-    if (!interruptAccept) return; // too early to process records
-    asynReadHandler(data, numchars, eomReason);
+    replySizes[replySizeCount++ % ReplySizeHistory] = size;
+    n = replySizeCount < ReplySizeHistory ? replySizeCount : ReplySizeHistory;
+    for (i = 0; i < n; i++)
+    {
+        // insertion sort, n is small
+        for (j = i; j > 0 && sorted[j-1] > replySizes[i]; j--)
+            sorted[j] = sorted[j-1];
+        sorted[j] = replySizes[i];
+    }
+    // read one byte more than needed to get the end (e.g. terminator) too
+    readSize = sorted[(n * 95 + 99) / 100 - 1] + 1;
+    if (streamReadSizeLimit > 0 && readSize > (size_t)streamReadSizeLimit)
+        readSize = streamReadSizeLimit;
+    debug2("AsynDriverInterface::recordReplySize(%s, %" Z "u) readSize=%" Z "u\n",
+        clientName(), size, readSize);
 }
 
-// get asynchronous input
-void AsynDriverInterface::
-asynReadHandler(const char *buffer, size_t received, int eomReason)
+AsynIntrDispatcher::
+AsynIntrDispatcher(const char* portname, int addr) :
+    next(NULL), portname(portname), addr(addr), pasynUser(NULL),
+    pasynOctet(NULL), pvtOctet(NULL), intrPvtOctet(NULL),
+    eosCache(NULL), entries(NULL), indexes(NULL), serial(0), busy(0),
+    readerUser(NULL), readerTimeout(0), readerQueued(false),
+    readerStopping(false), readerTimerQueue(NULL), readerTimer(NULL)
 {
-    // Due to multithreading, timerExpired() might come at any time.
-    // It queues the next poll request which is now useless because
-    // we got asynchronous input.
-    // Unfortunately, we  must be very careful not to block in this
-    // function. That means, we must not call cancelRequest() from here!
-    // We must also not call cancelRequest() in any other method that
-    // might have been called in port thread context, like finish().
-    // Luckily, that request cannot be active right now, because we are
-    // inside the read handler of some other asynUser in the port thread.
-    // Thus, it is sufficient to mark the request as obsolete by
-    // setting ioAction=None. See handleRequest().
-
-    debug("AsynDriverInterface::asynReadHandler(%s, buffer=\"%s\", "
-            "received=%ld eomReason=%s) ioAction=%s\n",
-        clientName(), StreamBuffer(buffer, received).expand()(),
-        (long)received, eomReasonToStr(eomReason), toStr(ioAction));
+}
 
-    ioAction = None;
-    ssize_t readMore = 1;
-    if (received)
+AsynIntrDispatcher::
+~AsynIntrDispatcher()
+{
+    if (readerUser)
     {
-        // At the moment, it seems that asynDriver does not cut off
-        // terminators for interrupt users and never sets eomReason.
-        // This may change in future releases of asynDriver.
-
-        asynStatus status;
-        const char* streameos;
-        size_t streameoslen;
-        streameos = getInTerminator(streameoslen);
-        char deveos[16]; // I guess that is sufficient
-        int deveoslen;
-
-        if (eomReason & ASYN_EOM_EOS)
-        {
-            // Terminator was cut off.
-            // If terminator is handled by stream, then we must
-            // restore the terminator, because the "real" terminator
-            // might be longer than what the octet driver supports.
-
-            if (!streameos)  // stream has not defined eos
-            {
-                // Just handle eos as normal end condition
-                // and don't try to add it.
-                eomReason |= ASYN_EOM_END;
-            }
-            else
-            {
-                // Try to add terminator
-                status = pasynOctet->getInputEos(pvtOctet,
-                    pasynUser, deveos, sizeof(deveos)-1, &deveoslen);
-                if (status == asynSuccess)
-                {
-                    // We can't just append terminator to buffer, because
-                    // we don't own that piece of memory.
-                    // First process received data with cut-off terminator
-                    readCallback(StreamIoSuccess, buffer, received);
-                    // then add terminator
-                    buffer = deveos;
-                    received = deveoslen;
-                }
-            }
-        }
-        else if (!streameos)
-        {
-            // If terminator was not cut off and terminator was not
-            // set by stream, cut it off now.
-            status = pasynOctet->getInputEos(pvtOctet,
-                pasynUser, deveos, sizeof(deveos)-1, &deveoslen);
-            if (status == asynSuccess && (long)received >= (long)deveoslen)
-            {
-                int i;
-                for (i = 1; i <= deveoslen; i++)
-                {
-                    if (buffer[received - i] != deveos[deveoslen - i]) break;
-                }
-                if (i > deveoslen) // terminator found
-                {
-                    received -= deveoslen;
-                    eomReason |= ASYN_EOM_END;
-                }
-            }
-        }
-        readMore = readCallback(
-            eomReason & ASYN_EOM_END ?
-            StreamIoEnd : StreamIoSuccess,
-            buffer, received);
+        int wasQueued;
+        readerLock.lock();
+        readerStopping = true;
+        readerLock.unlock();
+        // does not return until running expire() has finished
+        readerTimer->destroy();
+        readerTimerQueue->release();
+        // does not return until running handler has finished
+        pasynManager->cancelRequest(readerUser, &wasQueued);
+        pasynManager->exceptionCallbackRemove(readerUser);
+        pasynManager->disconnect(readerUser);
+        pasynManager->freeAsynUser(readerUser);
     }
-    if (readMore)
+    if (intrPvtOctet)
     {
-        // wait for more input
-        ioAction = AsyncReadMore;
-        startTimer(readTimeout);
+        // does not return until running callback has finished
+        pasynOctet->cancelInterruptUser(pvtOctet,
+            pasynUser, intrPvtOctet);
+    }
+    if (eosCache)
+    {
+        AsynEosCache::detach(eosCache);
+    }
+    if (pasynUser)
+    {
+        pasynManager->disconnect(pasynUser);
+        pasynManager->freeAsynUser(pasynUser);
+    }
+    while (indexes)
+    {
+        Index* index = indexes;
+        indexes = index->next;
+        freeNodes(index->root.children);
+        delete index;
     }
-    debug("AsynDriverInterface::asynReadHandler(%s) readMore=%" Z "d, ioAction=%s \n",
-        clientName(), readMore, toStr(ioAction));
 }
 
-// interface function: we want to receive an event
-bool AsynDriverInterface::
-acceptEvent(unsigned long mask, unsigned long replytimeout_ms)
+bool AsynIntrDispatcher::
+connect()
 {
-    if (receivedEvent & mask)
-    {
-        // handle early events
-        receivedEvent = 0;
-        eventCallback();
-        return true;
-    }
-    eventMask = mask;
-    ioAction = ReceiveEvent;
-    if (replytimeout_ms) startTimer(replytimeout_ms*0.001);
-    return true;
+    pasynUser = pasynManager->createAsynUser(NULL, NULL);
+    pasynUser->userPvt = this;
+    if (pasynManager->connectDevice(pasynUser, portname(), addr)
+        != asynSuccess)
+        return false;
+    asynInterface* pasynInterface = pasynManager->findInterface(pasynUser,
+        asynOctetType, true);
+    if (!pasynInterface)
+        return false;
+    pasynOctet = static_cast<asynOctet*>(pasynInterface->pinterface);
+    pvtOctet = pasynInterface->drvPvt;
+    eosCache = AsynEosCache::attach(portname(), addr);
+    return pasynOctet->registerInterruptUser(pvtOctet, pasynUser,
+        intrCallbackOctet, this, &intrPvtOctet) == asynSuccess;
 }
 
-void AsynDriverInterface::
-intrCallbackInt32(epicsInt32 data)
+bool AsynIntrDispatcher::
+attach(AsynDriverInterface* interface)
 {
-    debug("AsynDriverInterface::intrCallbackInt32 (%s, %ld)\n",
-        clientName(), (long int) data);
-    if (eventMask)
+    const char* terminator;
+    const char* prefixes;
+    size_t termlen = 0;
+    size_t prefixlen = 0;
+    AsynIntrDispatcher* dispatcher;
+
+    terminator = interface->getInTerminator(termlen);
+    prefixes = interface->getInPrefixes(prefixlen);
+    if (!terminator) termlen = 0;
+    if (!prefixes || !termlen) prefixlen = 0;
+
+    lock.lock();
+    dispatcher = interface->dispatcher;
+    if (dispatcher)
     {
-        if (data & eventMask)
+        // re-index only if the protocol has changed
+        if (interface->indexedTerminator.length() != termlen ||
+            !interface->indexedTerminator.startswith(terminator, termlen) ||
+            interface->indexedPrefixes.length() != prefixlen ||
+            !interface->indexedPrefixes.startswith(prefixes, prefixlen))
         {
-            eventMask = 0;
-            eventCallback();
+            dispatcher->remove(interface);
+            dispatcher->insert(interface,
+                terminator, termlen, prefixes, prefixlen);
+        }
+        lock.unlock();
+        return true;
+    }
+
+    const char* portname;
+    int addr;
+    if (pasynManager->getPortName(interface->pasynUser, &portname)
+            != asynSuccess ||
+        pasynManager->getAddr(interface->pasynUser, &addr)
+            != asynSuccess)
+    {
+        error("%s: cannot get asyn port and address: %s\n",
+            interface->clientName(), interface->pasynUser->errorMessage);
+        lock.unlock();
+        return false;
+    }
+    for (dispatcher = first; dispatcher; dispatcher = dispatcher->next)
+    {
+        if (dispatcher->addr == addr &&
+            strcmp(dispatcher->portname(), portname) == 0) break;
+    }
+    if (!dispatcher)
+    {
+        debug("AsynIntrDispatcher::attach(%s): new dispatcher for %s %d\n",
+            interface->clientName(), portname, addr);
+        dispatcher = new AsynIntrDispatcher(portname, addr);
+        if (!dispatcher->connect())
+        {
+            error("%s: asyn port %s does not support asynchronous input: %s\n",
+                interface->clientName(), interface->name(),
+                dispatcher->pasynUser->errorMessage);
+            delete dispatcher;
+            lock.unlock();
+            return false;
+        }
+        if (streamIntrReader > 0 && !dispatcher->connectReader())
+        {
+            debug("AsynIntrDispatcher::attach(%s): no reader for %s %d, "
+                "clients poll\n",
+                interface->clientName(), portname, addr);
+        }
+        dispatcher->next = first;
+        first = dispatcher;
+    }
+    Entry** pentry;
+    for (pentry = &dispatcher->entries; *pentry; pentry = &(*pentry)->next);
+    *pentry = new Entry;
+    (*pentry)->interface = interface;
+    (*pentry)->next = NULL;
+    interface->dispatcher = dispatcher;
+    dispatcher->insert(interface, terminator, termlen, prefixes, prefixlen);
+    lock.unlock();
+    return true;
+}
+
+void AsynIntrDispatcher::
+detach(AsynDriverInterface* interface)
+{
+    AsynIntrDispatcher* dispatcher = interface->dispatcher;
+    if (!dispatcher) return;
+
+    lock.lock();
+    dispatcher->remove(interface);
+    Entry** pentry;
+    for (pentry = &dispatcher->entries; *pentry; pentry = &(*pentry)->next)
+    {
+        if ((*pentry)->interface == interface)
+        {
+            Entry* entry = *pentry;
+            *pentry = entry->next;
+            delete entry;
+            break;
+        }
+    }
+    interface->dispatcher = NULL;
+    // wait until running callbacks are done with the interface
+    while (dispatcher->busy)
+    {
+        lock.unlock();
+        dispatcher->idle.wait();
+        lock.lock();
+    }
+    dispatcher->idle.signal(); // in case someone else waits, too
+    if (dispatcher->entries)
+    {
+        lock.unlock();
+        return;
+    }
+    // last client gone
+    AsynIntrDispatcher** pdispatcher;
+    for (pdispatcher = &first; *pdispatcher; pdispatcher = &(*pdispatcher)->next)
+    {
+        if (*pdispatcher == dispatcher)
+        {
+            *pdispatcher = dispatcher->next;
+            break;
+        }
+    }
+    lock.unlock();
+    // cancel interrupt user outside the lock because
+    // a running callback may wait for the lock
+    debug("AsynIntrDispatcher::detach(%s): delete dispatcher for %s %d\n",
+        interface->clientName(), dispatcher->portname(), dispatcher->addr);
+    delete dispatcher;
+}
+
+void AsynIntrDispatcher::
+insert(AsynDriverInterface* interface,
+    const char* terminator, size_t termlen,
+    const char* prefixes, size_t prefixlen)
+{
+    // code layout of prefixes:
+    // (length prefix)*
+    interface->indexedTerminator.set(terminator, termlen);
+    interface->indexedPrefixes.set(prefixes, prefixlen);
+    if (!prefixlen) return; // not indexed: gets all input
+
+    Index* index;
+    for (index = indexes; index; index = index->next)
+    {
+        if (index->terminator.length() == termlen &&
+            index->terminator.startswith(terminator, termlen)) break;
+    }
+    if (!index)
+    {
+        index = new Index;
+        index->terminator.set(terminator, termlen);
+        index->next = indexes;
+        indexes = index;
+    }
+    size_t i = 0;
+    while (i < prefixlen)
+    {
+        size_t length = (unsigned char)prefixes[i++];
+        Node* node = &index->root;
+        for (; length && i < prefixlen; length--, i++)
+        {
+            Node** pchild;
+            for (pchild = &node->children;
+                *pchild && (*pchild)->byte != (unsigned char)prefixes[i];
+                pchild = &(*pchild)->sibling);
+            if (!*pchild) *pchild = new Node(prefixes[i]);
+            node = *pchild;
+        }
+        Entry* entry = new Entry;
+        entry->interface = interface;
+        entry->next = node->entries;
+        node->entries = entry;
+    }
+    debug("AsynIntrDispatcher::insert(%s): prefixes \"%s\"\n",
+        interface->clientName(),
+        StreamBuffer(prefixes, prefixlen).expand()());
+}
+
+void AsynIntrDispatcher::
+remove(AsynDriverInterface* interface)
+{
+    // Empty nodes stay until the last client of the port is gone.
+    if (!interface->indexedPrefixes) return;
+    Index* index;
+    for (index = indexes; index; index = index->next)
+        remove(&index->root, interface);
+    interface->indexedPrefixes.clear();
+    interface->indexedTerminator.clear();
+}
+
+void AsynIntrDispatcher::
+remove(Node* node, AsynDriverInterface* interface)
+{
+    Entry** pentry = &node->entries;
+    while (*pentry)
+    {
+        if ((*pentry)->interface == interface)
+        {
+            Entry* entry = *pentry;
+            *pentry = entry->next;
+            delete entry;
+        }
+        else pentry = &(*pentry)->next;
+    }
+    for (node = node->children; node; node = node->sibling)
+        remove(node, interface);
+}
+
+void AsynIntrDispatcher::
+freeNodes(Node* node)
+{
+    while (node)
+    {
+        Node* sibling = node->sibling;
+        freeNodes(node->children);
+        while (node->entries)
+        {
+            Entry* entry = node->entries;
+            node->entries = entry->next;
+            delete entry;
+        }
+        delete node;
+        node = sibling;
+    }
+}
+
+void AsynIntrDispatcher::
+markCandidates(Index* index, const char* data, size_t numchars,
+    int eomReason)
+{
+    // Messages start at the beginning of the input if the previous
+    // input had ended with a terminator, and after each terminator.
+    // A terminator may have started in the previous input.
+    const char* terminator = index->terminator();
+    size_t termlen = index->terminator.length();
+    size_t taillen = index->tail.length();
+    bool atStart = index->atStart;
+    size_t i, j;
+
+    if (!numchars) return;
+    if (atStart) match(&index->root, data, numchars);
+    atStart = false;
+    for (i = 0; i < numchars; i++)
+    {
+        if (data[i] != terminator[termlen-1]) continue;
+        for (j = 1; j < termlen; j++)
+        {
+            char c;
+            if (j <= i) c = data[i-j];
+            else if (j-i <= taillen) c = index->tail[taillen-(j-i)];
+            else break;
+            if (c != terminator[termlen-1-j]) break;
+        }
+        if (j < termlen) continue;
+        if (i+1 < numchars)
+            match(&index->root, data+i+1, numchars-i-1);
+        else
+            atStart = true;
+    }
+    index->atStart = atStart || (eomReason & (ASYN_EOM_EOS|ASYN_EOM_END));
+    if (termlen > 1)
+    {
+        if (numchars >= termlen-1)
+            index->tail.set(data+numchars-(termlen-1), termlen-1);
+        else
+        {
+            index->tail.append(data, numchars);
+            if (index->tail.length() > termlen-1)
+                index->tail.remove(index->tail.length()-(termlen-1));
+        }
+    }
+}
+
+void AsynIntrDispatcher::
+match(Node* node, const char* data, size_t numchars)
+{
+    // walk down the tree along the input and mark all
+    // clients with a prefix that matches
+    while (numchars)
+    {
+        for (node = node->children;
+            node && node->byte != (unsigned char)*data;
+            node = node->sibling);
+        if (!node) return;
+        mark(node->entries);
+        data++;
+        numchars--;
+    }
+    // input ended within a prefix:
+    // message may continue in the next input
+    markAll(node);
+}
+
+void AsynIntrDispatcher::
+markAll(Node* node)
+{
+    mark(node->entries);
+    for (node = node->children; node; node = node->sibling)
+        markAll(node);
+}
+
+bool AsynIntrDispatcher::
+connectReader()
+{
+    int canBlock = 0;
+
+    readerUser = pasynManager->createAsynUser(readHandler, NULL);
+    readerUser->userPvt = this;
+    if (pasynManager->connectDevice(readerUser, portname(), addr)
+            != asynSuccess ||
+        pasynManager->canBlock(readerUser, &canBlock) != asynSuccess ||
+        !canBlock)
+    {
+        // a blocking read of a synchronous port would block the caller
+        pasynManager->disconnect(readerUser);
+        pasynManager->freeAsynUser(readerUser);
+        readerUser = NULL;
+        return false;
+    }
+    readerTimeout = streamIntrReader * 0.001;
+    readerTimerQueue = &epicsTimerQueueActive::allocate(true);
+    readerTimer = &readerTimerQueue->createTimer();
+    pasynManager->exceptionCallbackAdd(readerUser, readerException);
+    queueReader();
+    return true;
+}
+
+void AsynIntrDispatcher::
+queueReader()
+{
+    int connected = 0;
+    int autoconnect = 0;
+
+    readerLock.lock();
+    if (!readerStopping && !readerQueued)
+    {
+        pasynManager->isConnected(readerUser, &connected);
+        pasynManager->isAutoConnect(readerUser, &autoconnect);
+        // An explicitly disconnected port would be connected again
+        // by the request. Wait for readerException() instead.
+        if (connected || !autoconnect)
+        {
+            readerQueued = pasynManager->queueRequest(readerUser,
+                asynQueuePriorityLow, -1.0) == asynSuccess;
+            if (!readerQueued)
+                debug("AsynIntrDispatcher::queueReader(%s %d): %s\n",
+                    portname(), addr, readerUser->errorMessage);
+        }
+    }
+    readerLock.unlock();
+}
+
+void AsynIntrDispatcher::
+readerException(asynUser *pasynUser, asynException exception)
+{
+    AsynIntrDispatcher* dispatcher =
+        static_cast<AsynIntrDispatcher*>(pasynUser->userPvt);
+    int connected = 0;
+
+    if (exception != asynExceptionConnect) return;
+    pasynManager->isConnected(pasynUser, &connected);
+    if (connected) dispatcher->queueReader();
+}
+
+void AsynIntrDispatcher::
+readHandler()
+{
+    size_t received = 0;
+    int eomReason = 0;
+    asynStatus status;
+
+    readerLock.lock();
+    readerQueued = false;
+    readerLock.unlock();
+    readerUser->timeout = readerTimeout;
+    status = pasynOctet->read(pvtOctet, readerUser,
+        readerBuffer, sizeof(readerBuffer), &received, &eomReason);
+    // the driver has already passed the input to dispatch()
+    debug2("AsynIntrDispatcher::readHandler(%s %d): read() = %s "
+        "after %" Z "u bytes\n",
+        portname(), addr, AsynDriverInterface::toStr(status), received);
+    if (status != asynSuccess && status != asynTimeout)
+    {
+        // do not spin on a failing port, but do not block it either
+        readerTimer->start(*this, readerTimeout);
+        return;
+    }
+    queueReader();
+}
+
+void AsynIntrDispatcher::
+dispatch(char *data, size_t numchars, int eomReason)
+{
+    if (!interruptAccept) return; // too early to process records
+
+    StreamBuffer receivers;
+    AsynDriverInterface* interface;
+    Entry* entry;
+    Index* index;
+    size_t i;
+
+    lock.lock();
+    serial++;
+    for (index = indexes; index; index = index->next)
+        markCandidates(index, data, numchars, eomReason);
+    for (entry = entries; entry; entry = entry->next)
+    {
+        interface = entry->interface;
+        // clients not waiting for a new message get all input
+        if (interface->dispatchMark == serial ||
+            !interface->indexedPrefixes ||
+            interface->ioAction != AsynDriverInterface::AsyncRead ||
+            interface->inputPending())
+        {
+            receivers.append(&interface, sizeof(interface));
+        }
+    }
+    if (!receivers)
+    {
+        lock.unlock();
+        return;
+    }
+    busy++;
+    lock.unlock();
+
+    debug2("AsynIntrDispatcher::dispatch(%s %d): \"%s\" to %" Z "u clients\n",
+        portname(), addr, StreamBuffer(data, numchars).expand()(),
+        receivers.length()/sizeof(interface));
+
+    // Frame the input once for all clients, in two flavours:
+    // Clients with a terminator of their own need the terminator,
+    // clients without get the input with the asyn EOS removed.
+    // At the moment, it seems that asynDriver does not cut off
+    // terminators for interrupt users and never sets eomReason.
+    // This may change in future releases of asynDriver.
+    // All clients share the same copy of the input. It is valid
+    // until all callbacks have returned, which is all they need.
+    char deveos[16]; // I guess that is sufficient
+    int deveoslen = 0;
+    if (numchars && eosCache->get(eosCache->input,
+        pasynOctet->getInputEos, pvtOctet, pasynUser,
+        deveos, sizeof(deveos)-1, &deveoslen) != asynSuccess)
+    {
+        deveoslen = 0;
+    }
+    StreamBuffer withEos;
+    const char* withEosData = data;
+    size_t withEosSize = numchars;
+    int withEosReason = eomReason;
+    size_t withoutEosSize = numchars;
+    int withoutEosReason = eomReason;
+    if (eomReason & ASYN_EOM_EOS)
+    {
+        // Terminator was cut off.
+        // We can't just append terminator to data, because
+        // we don't own that piece of memory.
+        // The "real" terminator might be longer than what the octet
+        // driver supports, thus leave it to StreamCore to check it.
+        if (deveoslen)
+        {
+            withEos.append(data, numchars).append(deveos, deveoslen);
+            withEosData = withEos();
+            withEosSize = withEos.length();
+        }
+        withoutEosReason |= ASYN_EOM_END;
+    }
+    else if (deveoslen && numchars >= (size_t)deveoslen &&
+        memcmp(data + numchars - deveoslen, deveos, deveoslen) == 0)
+    {
+        // terminator found, cut it off now
+        withoutEosSize -= deveoslen;
+        withoutEosReason |= ASYN_EOM_END;
+    }
+
+    for (i = 0; i < receivers.length(); i += sizeof(interface))
+    {
+        memcpy(&interface, receivers(i), sizeof(interface));
+        size_t termlen;
+        if (interface->getInTerminator(termlen))
+            interface->intrCallbackOctet(withEosData, withEosSize,
+                withEosReason);
+        else
+            interface->intrCallbackOctet(data, withoutEosSize,
+                withoutEosReason);
+    }
+
+    lock.lock();
+    if (--busy == 0) idle.signal();
+    lock.unlock();
+}
+
+AsynRequestCoalescer::
+AsynRequestCoalescer(AsynDriverInterface* leader,
+    const char* portname, int addr, const void* output, size_t size,
+    const char* terminator, size_t termlen) :
+    next(NULL), portname(portname), addr(addr), output(output, size),
+    terminator(terminator, termlen), leader(leader), followers(NULL),
+    lockStatus(StreamIoFault), writeStatus(StreamIoFault), written(false),
+    replyStatus(StreamIoNoReply), reads(0)
+{
+    epicsTimeGetCurrent(&started);
+}
+
+bool AsynRequestCoalescer::
+join(AsynDriverInterface* interface,
+    const void* output, size_t size, unsigned long window_ms)
+{
+    const char* terminator;
+    size_t termlen = 0;
+    const char* portname;
+    int addr;
+    epicsTimeStamp now;
+    AsynRequestCoalescer* coalescer;
+
+    if (interface->coalescer) leave(interface);
+    if (pasynManager->getPortName(interface->pasynUser, &portname)
+            != asynSuccess ||
+        pasynManager->getAddr(interface->pasynUser, &addr)
+            != asynSuccess)
+        return false;
+    terminator = interface->getInTerminator(termlen);
+    if (!terminator) termlen = 0;
+    epicsTimeGetCurrent(&now);
+
+    lock.lock();
+    for (coalescer = first; coalescer; coalescer = coalescer->next)
+    {
+        if (coalescer->addr == addr &&
+            coalescer->output.length() == size &&
+            coalescer->output.startswith(output, size) &&
+            coalescer->terminator.length() == termlen &&
+            coalescer->terminator.startswith(terminator, termlen) &&
+            strcmp(coalescer->portname(), portname) == 0 &&
+            epicsTimeDiffInSeconds(&now, &coalescer->started)*1000
+                < window_ms)
+            break;
+    }
+    if (coalescer)
+    {
+        debug("AsynRequestCoalescer::join(%s): follow %s\n",
+            interface->clientName(), coalescer->leader->clientName());
+        AsynDriverInterface** pfollower;
+        for (pfollower = &coalescer->followers; *pfollower;
+            pfollower = &(*pfollower)->coalesceNext);
+        *pfollower = interface;
+        interface->coalesceNext = NULL;
+        interface->coalescer = coalescer;
+        interface->coalesceWritten = false;
+        interface->coalesceReading = false;
+        interface->coalesceOffset = 0;
+        interface->coalesceReads = 0;
+        lock.unlock();
+        return true;
+    }
+    // nobody to follow: lead a new group
+    coalescer = new AsynRequestCoalescer(interface, portname, addr,
+        output, size, terminator, termlen);
+    coalescer->next = first;
+    first = coalescer;
+    interface->coalescer = coalescer;
+    lock.unlock();
+    return false;
+}
+
+void AsynRequestCoalescer::
+leave(AsynDriverInterface* interface)
+{
+    lock.lock();
+    AsynRequestCoalescer* coalescer = interface->coalescer;
+    if (!coalescer)
+    {
+        lock.unlock();
+        return;
+    }
+    if (coalescer->leader != interface)
+    {
+        AsynDriverInterface** pfollower;
+        for (pfollower = &coalescer->followers; *pfollower;
+            pfollower = &(*pfollower)->coalesceNext)
+        {
+            if (*pfollower == interface)
+            {
+                *pfollower = interface->coalesceNext;
+                break;
+            }
+        }
+        interface->coalescer = NULL;
+        lock.unlock();
+        return;
+    }
+    // leader leaves: nobody can join any more
+    AsynRequestCoalescer** pcoalescer;
+    for (pcoalescer = &first; *pcoalescer;
+        pcoalescer = &(*pcoalescer)->next)
+    {
+        if (*pcoalescer == coalescer)
+        {
+            *pcoalescer = coalescer->next;
+            break;
+        }
+    }
+    lock.unlock();
+    coalescer->close();
+    interface->coalescer = NULL;
+    delete coalescer;
+}
+
+bool AsynRequestCoalescer::
+reading(AsynDriverInterface* interface)
+{
+    // if the group is already closed, the follower has to read itself
+    lock.lock();
+    bool shared = interface->coalescer != NULL;
+    if (shared) interface->coalesceReading = true;
+    lock.unlock();
+    return shared;
+}
+
+void AsynRequestCoalescer::
+wrote(StreamIoStatus status)
+{
+    writeStatus = status;
+    written = true;
+    update();
+}
+
+void AsynRequestCoalescer::
+received(StreamIoStatus status, const void* input, size_t size)
+{
+    reply.append(input, size);
+    replyStatus = status;
+    reads++;
+    update();
+}
+
+void AsynRequestCoalescer::
+update()
+{
+    // Called in the context of the leader only.
+    // Callbacks may make followers leave, thus do not keep
+    // the lock and look for the next follower every time.
+    AsynDriverInterface* follower;
+    bool writeDone;
+    bool newInput;
+    size_t offset;
+    ssize_t readMore;
+
+    while (written)
+    {
+        lock.lock();
+        for (follower = followers; follower;
+            follower = follower->coalesceNext)
+        {
+            if (!follower->coalesceWritten ||
+                follower->coalesceReads != reads) break;
+        }
+        if (!follower)
+        {
+            lock.unlock();
+            return;
+        }
+        writeDone = follower->coalesceWritten;
+        newInput = follower->coalesceReads != reads;
+        offset = follower->coalesceOffset;
+        follower->coalesceWritten = true;
+        follower->coalesceOffset = reply.length();
+        follower->coalesceReads = reads;
+        lock.unlock();
+
+        if (!writeDone)
+        {
+            debug("AsynRequestCoalescer::update(%s): written for %s\n",
+                leader->clientName(), follower->clientName());
+            follower->lockCallback();
+            follower->writeCallback(writeStatus);
+        }
+        if (newInput)
+        {
+            readMore = follower->readCallback(replyStatus,
+                reply(offset), reply.length() - offset);
+            lock.lock();
+            if (follower->coalescer == this)
+                follower->coalesceReading = readMore != 0;
+            lock.unlock();
+        }
+    }
+}
+
+void AsynRequestCoalescer::
+close()
+{
+    AsynDriverInterface* follower;
+    bool writeDone;
+    bool readMore;
+
+    update();
+    while (1)
+    {
+        lock.lock();
+        follower = followers;
+        if (!follower)
+        {
+            lock.unlock();
+            return;
+        }
+        followers = follower->coalesceNext;
+        follower->coalescer = NULL;
+        writeDone = follower->coalesceWritten;
+        readMore = follower->coalesceReading;
+        lock.unlock();
+
+        if (!writeDone)
+        {
+            // leader has not written anything
+            debug("AsynRequestCoalescer::close(%s): nothing written for %s\n",
+                leader->clientName(), follower->clientName());
+            follower->lockCallback(lockStatus == StreamIoSuccess ?
+                StreamIoFault : lockStatus);
+        }
+        else if (readMore)
+        {
+            // leader got its reply but this follower wants more
+            debug("AsynRequestCoalescer::close(%s): %s wants more input\n",
+                leader->clientName(), follower->clientName());
+            follower->readCallback(replyStatus == StreamIoFault ?
+                StreamIoFault : reply ? StreamIoTimeout : StreamIoNoReply);
+        }
+    }
+}
+
+void AsynDriverInterface::
+intrCallbackOctet(const char *data, size_t numchars, int eomReason)
+{
+// Problems here:
+// 1. We get this message too when we are the poller.
+//    Thus we have to ignore what we got from polling.
+// 2. eomReason=ASYN_EOM_CNT when message was too long for
+//    internal buffer of asynDriver.
+
+    asynReadHandler(data, numchars, eomReason);
+}
+
+// get asynchronous input
+// (already framed by AsynIntrDispatcher::dispatch())
+void AsynDriverInterface::
+asynReadHandler(const char *buffer, size_t received, int eomReason)
+{
+    // Due to multithreading, timerExpired() might come at any time.
+    // It queues the next poll request which is now useless because
+    // we got asynchronous input.
+    // Unfortunately, we  must be very careful not to block in this
+    // function. That means, we must not call cancelRequest() from here!
+    // We must also not call cancelRequest() in any other method that
+    // might have been called in port thread context, like finish().
+    // Luckily, that request cannot be active right now, because we are
+    // inside the read handler of some other asynUser in the port thread.
+    // Thus, it is sufficient to mark the request as obsolete by
+    // setting ioAction=None. See handleRequest().
+
+    debug("AsynDriverInterface::asynReadHandler(%s, buffer=\"%s\", "
+            "received=%ld eomReason=%s) ioAction=%s\n",
+        clientName(), StreamBuffer(buffer, received).expand()(),
+        (long)received, eomReasonToStr(eomReason), toStr(ioAction));
+
+    ioAction = None;
+    ssize_t readMore = 1;
+    if (received)
+    {
+        readMore = readCallback(
+            eomReason & ASYN_EOM_END ?
+            StreamIoEnd : StreamIoSuccess,
+            buffer, received);
+    }
+    if (readMore)
+    {
+        // wait for more input
+        ioAction = AsyncReadMore;
+        startTimer(readTimeout);
+    }
+    debug("AsynDriverInterface::asynReadHandler(%s) readMore=%" Z "d, ioAction=%s \n",
+        clientName(), readMore, toStr(ioAction));
+}
+
+// interface function: we want to receive an event
+bool AsynDriverInterface::
+acceptEvent(unsigned long mask, unsigned long replytimeout_ms)
+{
+    if (receivedEvent & mask)
+    {
+        // handle early events
+        receivedEvent = 0;
+        eventCallback();
+        return true;
+    }
+    eventMask = mask;
+    ioAction = ReceiveEvent;
+    if (replytimeout_ms) startTimer(replytimeout_ms*0.001);
+    return true;
+}
+
+void AsynDriverInterface::
+intrCallbackInt32(epicsInt32 data)
+{
+    debug("AsynDriverInterface::intrCallbackInt32 (%s, %ld)\n",
+        clientName(), (long int) data);
+    if (eventMask)
+    {
+        if (data & eventMask)
+        {
+            eventMask = 0;
+            eventCallback();
         }
         return;
     }
@@ -1273,6 +2486,9 @@ exceptionHandler(asynException exception)
     debug("AsynDriverInterface::exceptionHandler(%s, %s)\n",
         clientName(), toStr(exception));
 
+    // EOS may have been changed
+    eosCache->invalidate();
+
     if (exception == asynExceptionConnect)
     {
         pasynManager->isConnected(pasynUser, &connected);
@@ -1316,7 +2532,7 @@ timerExpired()
                 // has explicitely been disconnected
                 // a poll would autoConnect which is not what we want
                 // just retry later
-                startTimer(replyTimeout);
+                startTimer(nextPoll());
             }
             else
             {
@@ -1328,7 +2544,7 @@ timerExpired()
                     "queueRequest(..., priority=Low, queueTimeout=-1) = %s %s\n",
                     clientName(), toStr(status),
                     status!=asynSuccess ? pasynUser->errorMessage : "");
-                if (status != asynSuccess) startTimer(replyTimeout);
+                if (status != asynSuccess) startTimer(nextPoll());
                 // continues with:
                 //    handleRequest() -> readHandler() -> readCallback()
             }
@@ -1397,6 +2613,7 @@ disconnectHandler()
     if (connected)
     {
         status = pasynCommon->disconnect(pvtCommon, pasynUser);
+        eosCache->invalidate();
         if (status != asynSuccess)
         {
             error("%s connectRequest: pasynCommon->disconnect() failed: %s\n",
@@ -1416,6 +2633,11 @@ finish()
         clientName());
     cancelTimer();
     ioAction = None;
+    if (coalescer)
+    {
+        AsynRequestCoalescer::leave(this);
+    }
+    following = false;
 //     if (pasynGpib)
 //     {
 //         // Release GPIB device the the end of the protocol
@@ -1426,6 +2648,260 @@ finish()
         clientName());
 }
 
+void AsynDriverInterface::
+printStatus(StreamBuffer& buffer)
+{
+    buffer.print(" drained=%lu readsize=%" Z "u",
+        drain ? drain->drained : 0UL, readSize);
+    if (ioAction == AsyncRead && pollDelay > 0)
+        buffer.print(" poll=%.0fms", pollDelay*1000);
+}
+
+// Period until the next poll for async input. With PollPeriodMax,
+// start at PollPeriod and double it after each poll without input.
+double AsynDriverInterface::
+nextPoll()
+{
+    if (pollDelay == 0 || pollDelayMax <= replyTimeout)
+        pollDelay = replyTimeout;
+    else if (pollDelay < pollDelayMax)
+    {
+        pollDelay *= 2;
+        if (pollDelay > pollDelayMax) pollDelay = pollDelayMax;
+    }
+    return pollDelay;
+}
+
+asynStatus AsynDriverInterface::
+getInputEos(char* eos, int size, int* len)
+{
+    return eosCache->get(eosCache->input, pasynOctet->getInputEos,
+        pvtOctet, pasynUser, eos, size, len);
+}
+
+asynStatus AsynDriverInterface::
+setInputEos(const char* eos, int len)
+{
+    return eosCache->set(eosCache->input, pasynOctet->setInputEos,
+        pvtOctet, pasynUser, eos, len);
+}
+
+asynStatus AsynDriverInterface::
+getOutputEos(char* eos, int size, int* len)
+{
+    return eosCache->get(eosCache->output, pasynOctet->getOutputEos,
+        pvtOctet, pasynUser, eos, size, len);
+}
+
+asynStatus AsynDriverInterface::
+setOutputEos(const char* eos, int len)
+{
+    return eosCache->set(eosCache->output, pasynOctet->setOutputEos,
+        pvtOctet, pasynUser, eos, len);
+}
+
+AsynEosCache* AsynEosCache::
+attach(const char* portname, int addr)
+{
+    AsynEosCache* cache;
+
+    listLock.lock();
+    for (cache = first; cache; cache = cache->next)
+    {
+        if (cache->addr == addr &&
+            strcmp(cache->portname(), portname) == 0) break;
+    }
+    if (!cache)
+    {
+        cache = new AsynEosCache(portname, addr);
+        cache->next = first;
+        first = cache;
+    }
+    cache->refcount++;
+    listLock.unlock();
+    return cache;
+}
+
+void AsynEosCache::
+detach(AsynEosCache* cache)
+{
+    listLock.lock();
+    if (--cache->refcount)
+    {
+        listLock.unlock();
+        return;
+    }
+    AsynEosCache** pcache;
+    for (pcache = &first; *pcache; pcache = &(*pcache)->next)
+    {
+        if (*pcache == cache)
+        {
+            *pcache = cache->next;
+            break;
+        }
+    }
+    listLock.unlock();
+    delete cache;
+}
+
+asynStatus AsynEosCache::
+get(Eos& cached, GetEos getEos, void* pvt, asynUser* pasynUser,
+    char* eos, int size, int* len)
+{
+    asynStatus status;
+
+    lock.lock();
+    if (!cached.valid)
+    {
+        cached.status = getEos(pvt, pasynUser,
+            cached.eos, sizeof(cached.eos)-1, &cached.len);
+        if (cached.status == asynSuccess)
+            cached.eos[cached.len] = 0;
+        cached.valid = true;
+    }
+    status = cached.status;
+    if (status == asynSuccess)
+    {
+        if (cached.len > size)
+        {
+            status = asynOverflow;
+        }
+        else
+        {
+            // like the driver: terminate if possible
+            memcpy(eos, cached.eos, cached.len);
+            if (cached.len < size) eos[cached.len] = 0;
+            *len = cached.len;
+        }
+    }
+    lock.unlock();
+    return status;
+}
+
+asynStatus AsynEosCache::
+set(Eos& cached, SetEos setEos, void* pvt, asynUser* pasynUser,
+    const char* eos, int len)
+{
+    asynStatus status;
+
+    lock.lock();
+    if (cached.valid && cached.status == asynSuccess &&
+        cached.len == len && (len == 0 || memcmp(cached.eos, eos, len) == 0))
+    {
+        // already installed
+        lock.unlock();
+        return asynSuccess;
+    }
+    status = setEos(pvt, pasynUser, eos, len);
+    if (status == asynSuccess && len < (int)sizeof(cached.eos))
+    {
+        cached.valid = true;
+        cached.status = asynSuccess;
+        cached.len = len;
+        if (len) memcpy(cached.eos, eos, len);
+        cached.eos[len] = 0;
+    }
+    else
+    {
+        // don't know what the driver did
+        cached.valid = false;
+    }
+    lock.unlock();
+    return status;
+}
+
+void AsynEosCache::
+invalidate()
+{
+    lock.lock();
+    input.valid = false;
+    output.valid = false;
+    lock.unlock();
+}
+
+AsynInputDrain* AsynInputDrain::
+attach(const char* portname, int addr)
+{
+    AsynInputDrain* drain;
+
+    listLock.lock();
+    for (drain = first; drain; drain = drain->next)
+    {
+        if (drain->addr == addr &&
+            strcmp(drain->portname(), portname) == 0) break;
+    }
+    if (!drain)
+    {
+        drain = new AsynInputDrain(portname, addr);
+        drain->next = first;
+        first = drain;
+    }
+    drain->refcount++;
+    listLock.unlock();
+    return drain;
+}
+
+void AsynInputDrain::
+detach(AsynInputDrain* drain)
+{
+    listLock.lock();
+    if (--drain->refcount)
+    {
+        listLock.unlock();
+        return;
+    }
+    AsynInputDrain** pdrain;
+    for (pdrain = &first; *pdrain; pdrain = &(*pdrain)->next)
+    {
+        if (*pdrain == drain)
+        {
+            *pdrain = drain->next;
+            break;
+        }
+    }
+    listLock.unlock();
+    delete drain;
+}
+
+// interface function: share the request of an other client
+bool AsynDriverInterface::
+coalesceRequest(const void* output, size_t size, unsigned long window_ms)
+{
+    debug("AsynDriverInterface::coalesceRequest(%s, \"%s\", %ld msec)\n",
+        clientName(), StreamBuffer(output, size).expand()(), window_ms);
+    following = AsynRequestCoalescer::join(this, output, size, window_ms);
+    return following;
+    // continues with:
+    //    leader's writeCallback() -> lockCallback(), writeCallback()
+    //    leader's readCallback() -> readCallback()
+    // or leader's unlock() or finish() -> lockCallback(StreamIoFault)
+    // if we are the leader: continues with lockRequest()
+}
+
+void AsynDriverInterface::
+lockCallback(StreamIoStatus status)
+{
+    if (coalescer && coalescer->leader == this)
+        coalescer->lockStatus = status;
+    StreamBusInterface::lockCallback(status);
+}
+
+void AsynDriverInterface::
+writeCallback(StreamIoStatus status)
+{
+    if (coalescer && coalescer->leader == this)
+        coalescer->wrote(status);
+    StreamBusInterface::writeCallback(status);
+}
+
+ssize_t AsynDriverInterface::
+readCallback(StreamIoStatus status, const void* input, size_t size)
+{
+    if (coalescer && coalescer->leader == this)
+        coalescer->received(status, input, size);
+    return StreamBusInterface::readCallback(status, input, size);
+}
+
 // asynUser callbacks to pasynManager->queueRequest()
 
 void AsynDriverInterface::
@@ -1434,34 +2910,41 @@ handleRequest()
     cancelTimer();
     debug2("AsynDriverInterface::handleRequest(%s) %s\n",
         clientName(), toStr(ioAction));
-    switch (ioAction)
-    {
-        case None:
-            // ignore obsolete poll request
-            // see asynReadHandler()
-            break;
-        case Lock:
-            lockHandler();
-            break;
-        case Write:
-            writeHandler();
-            break;
-        case AsyncRead: // polled async input
-        case AsyncReadMore:
-        case Read:      // sync input
-            readHandler();
-            break;
-        case Connect:
-            connectHandler();
-            break;
-        case Disconnect:
-            disconnectHandler();
-            break;
-        default:
-            error("INTERNAL ERROR (%s): "
-                "handleRequest() unexpected ioAction %s\n",
-                clientName(), toStr(ioAction));
-    }
+    // Requests made by the callbacks of a handler are not queued again
+    // but handled in this loop after the handler has returned.
+    handlerThread = epicsThreadGetIdSelf();
+    do {
+        requestPending = false;
+        switch (ioAction)
+        {
+            case None:
+                // ignore obsolete poll request
+                // see asynReadHandler()
+                break;
+            case Lock:
+                lockHandler();
+                break;
+            case Write:
+                writeHandler();
+                break;
+            case AsyncRead: // polled async input
+            case AsyncReadMore:
+            case Read:      // sync input
+                readHandler();
+                break;
+            case Connect:
+                connectHandler();
+                break;
+            case Disconnect:
+                disconnectHandler();
+                break;
+            default:
+                error("INTERNAL ERROR (%s): "
+                    "handleRequest() unexpected ioAction %s\n",
+                    clientName(), toStr(ioAction));
+        }
+    } while (requestPending);
+    handlerThread = NULL;
 }
 
 void AsynDriverInterface::
@@ -20,130 +20,192 @@
 * along with StreamDevice. If not, see https://www.gnu.org/licenses/.
 *************************************************************************/
 
+#include <limits.h>
+#include <string.h>
+
 #include "StreamFormatConverter.h"
 #include "StreamError.h"
 
 // packed BCD (0x00 - 0x99)
 
+// byte -> 0...99 or 0xFF if not valid BCD
+static unsigned char bcdDecode[256];
+// 0...99 -> byte
+static unsigned char bcdEncode[100];
+
 class BCDConverter : public StreamFormatConverter
 {
     int parse (const StreamFormat&, StreamBuffer&, const char*&, bool);
     bool printLong(const StreamFormat&, StreamBuffer&, long);
     ssize_t scanLong(const StreamFormat&, const char*, long&);
+    bool printLongArray(const StreamFormat&, StreamBuffer&, const long*, size_t);
+    ssize_t scanLongArray(const StreamFormat&, const char*, size_t, long*, size_t&);
+public:
+    BCDConverter();
 };
 
+BCDConverter::
+BCDConverter()
+{
+    int i;
+    memset(bcdDecode, 0xFF, sizeof(bcdDecode));
+    for (i = 0; i < 100; i++)
+    {
+        bcdEncode[i] = (unsigned char)((i/10)<<4 | i%10);
+        bcdDecode[bcdEncode[i]] = (unsigned char)i;
+    }
+}
+
 int BCDConverter::
 parse(const StreamFormat& fmt, StreamBuffer&, const char*&, bool)
 {
     return (fmt.flags & sign_flag) ? signed_format : unsigned_format;
 }
 
-bool BCDConverter::
-printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
+static void encodeBCD(const StreamFormat& fmt, unsigned char* out,
+    unsigned long width, unsigned long prec, long value)
 {
-    unsigned char bcd;
-    long i, d, s;
-    unsigned long prec = fmt.prec < 0 ? 2 * sizeof(value) : fmt.prec; // number of nibbles
-    unsigned long width = (prec + (fmt.flags & sign_flag ? 2 : 1)) / 2;
+    unsigned long i;
     unsigned long val = value;
+    bool negative = fmt.flags & sign_flag && value < 0;
 
-    output.append('\0', width);
-    if (fmt.width > width) width = fmt.width;
-    if (fmt.flags & sign_flag && value < 0)
-        val = -value;
-    if (fmt.flags & alt_flag)
-    {
-        i = -(long)width;
-        d = 1;
-        s = -1;
-    }
-    else
-    {
-        i = -1;
-        d = -1;
-        s = -(long)width;
-    }
-    while (width && prec)
+    if (negative) val = -value;
+    memset(out, 0, width);
+    for (i = 0; i < width && prec; i++)
     {
-        width--;
-        bcd = val%10;
-        if (--prec)
+        unsigned char bcd;
+        if (prec >= 2)
         {
-            --prec;
-            val /= 10;
-            bcd |= (val%10)<<4;
-            val /= 10;
+            bcd = bcdEncode[val%100];
+            val /= 100;
+            prec -= 2;
         }
-        output[i] = bcd;
-        i += d;
-    }
-    if (fmt.flags & sign_flag && value < 0) {
-        output[s] |= 0xf0;
+        else
+        {
+            bcd = (unsigned char)(val%10);
+            prec = 0;
+        }
+        // little endian or big endian
+        out[fmt.flags & alt_flag ? i : width-1-i] = bcd;
     }
+    if (negative)
+        out[fmt.flags & alt_flag ? width-1 : 0] |= 0xf0;
+}
+
+bool BCDConverter::
+printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
+{
+    unsigned long prec = fmt.prec < 0 ? 2 * sizeof(value) : fmt.prec; // number of nibbles
+    unsigned long width = (prec + (fmt.flags & sign_flag ? 2 : 1)) / 2;
+    if (width < fmt.width) width = fmt.width; // pad with leading zeros
+
+    encodeBCD(fmt, (unsigned char*)output.reserve(width), width, prec, value);
     return true;
 }
 
-ssize_t BCDConverter::
-scanLong(const StreamFormat& fmt, const char* input, long& value)
+bool BCDConverter::
+printLongArray(const StreamFormat& fmt, StreamBuffer& output,
+    const long* values, size_t count)
+{
+    unsigned long prec = fmt.prec < 0 ? 2 * sizeof(long) : fmt.prec; // number of nibbles
+    unsigned long width = (prec + (fmt.flags & sign_flag ? 2 : 1)) / 2;
+    if (width < fmt.width) width = fmt.width;
+    unsigned char* out = (unsigned char*)output.reserve(width * count);
+    size_t i;
+
+    for (i = 0; i < count; i++, out += width)
+        encodeBCD(fmt, out, width, prec, values[i]);
+    return true;
+}
+
+// Decode at most fmt.width (default 1) bytes but not more than length.
+// Return number of valid bytes or -1 on overflow.
+static ssize_t decodeBCD(const StreamFormat& fmt, const unsigned char* input,
+    size_t length, long& value)
 {
-    ssize_t consumed = 0;
-    long val = 0;
-    unsigned char bcd1, bcd10;
-    long width = fmt.width;
+    size_t consumed = 0;
+    unsigned long val = 0;
+    unsigned char byte, bcd;
+    size_t width = fmt.width;
     if (width == 0) width = 1;
+    size_t last = width - 1;
+    if (width > length) width = length;
     if (fmt.flags & alt_flag)
     {
         // little endian
-        int shift = 1;
-        while (width--)
+        unsigned long shift = 1;
+        while (consumed < width)
         {
-            bcd1 = input[consumed++];
-            bcd10 = bcd1>>4;
-            bcd1 &= 0x0F;
-            bcd10 >>= 4;
-            if (bcd1 > 9 || shift * bcd1 < bcd1) break;
-            if (width == 0 && fmt.flags & sign_flag)
+            byte = input[consumed];
+            if (consumed == last && fmt.flags & sign_flag)
             {
-                val += bcd1 * shift;
-                if (bcd10 != 0) val = -val;
+                // last byte contains sign and one digit
+                bcd = byte & 0x0F;
+                if (bcd > 9) break;
+                val += bcd * shift;
+                consumed++;
+                if (byte & 0xF0) val = -val;
                 break;
             }
-            if (bcd10 > 9 || shift * bcd10 < bcd10) break;
-            val += (bcd1 + 10 * bcd10) * shift;
-            if (shift <= 100000000) shift *= 100;
+            bcd = bcdDecode[byte];
+            if (bcd > 99) break;
+            val += bcd * shift;
+            consumed++;
+            if (shift <= ULONG_MAX / 100) shift *= 100;
             else shift = 0;
         }
     }
     else
     {
         // big endian
-        int sign = 1;
-        while (width--)
+        bool negative = false;
+        while (consumed < width)
         {
-            long temp;
-            bcd1 = input[consumed];
-            bcd10 = bcd1>>4;
-            bcd1 &= 0x0F;
-            if (consumed == 0 && fmt.flags & sign_flag && bcd10)
+            byte = input[consumed];
+            if (consumed == 0 && fmt.flags & sign_flag && byte & 0xF0)
             {
-                sign = -1;
-                bcd10 = 0;
+                negative = true;
+                byte &= 0x0F;
             }
-            if (bcd1 > 9 || bcd10 > 9) break;
-            temp = val * 100 + (bcd1 + 10 * bcd10);
-            if (temp < val)
-            {
-                consumed = 0;
-                break;
-            }
-            val = temp;
+            bcd = bcdDecode[byte];
+            if (bcd > 99) break;
+            if (val > (unsigned long)(LONG_MAX - bcd) / 100) return -1;
+            val = val * 100 + bcd;
             consumed++;
         }
-        val *= sign;
+        if (negative) val = -val;
     }
-    if (consumed == 0) return -1;
     value = val;
     return consumed;
 }
 
+ssize_t BCDConverter::
+scanLong(const StreamFormat& fmt, const char* input, long& value)
+{
+    ssize_t consumed = decodeBCD(fmt,
+        (const unsigned char*)input, (size_t)-1, value);
+    if (consumed == 0) return -1;
+    return consumed;
+}
+
+ssize_t BCDConverter::
+scanLongArray(const StreamFormat& fmt, const char* input, size_t length,
+    long* values, size_t& count)
+{
+    size_t width = fmt.width ? fmt.width : 1;
+    size_t i, consumed = 0;
+    for (i = 0; i < count; i++)
+    {
+        ssize_t size = decodeBCD(fmt,
+            (const unsigned char*)input + consumed, length - consumed, values[i]);
+        if (size <= 0) break;
+        if (fmt.flags & fix_width_flag && (unsigned long)size != fmt.width) break;
+        // a short element at the end of the input is incomplete
+        if ((size_t)size < width && (size_t)size == length - consumed) break;
+        consumed += size;
+    }
+    count = i;
+    return consumed;
+}
+
 RegisterConverter (BCDConverter, "D");
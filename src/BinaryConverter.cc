@@ -22,19 +22,60 @@
 
 #include <ctype.h>
 #include <limits.h>
+#include <string.h>
+
+// pdep on x86_64, selected at run time (no -m flags needed)
+#if defined(__GNUC__) && defined(__x86_64__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || \
+    defined(__clang__))
+#include <immintrin.h>
+#define BITS_PDEP
+#endif
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "StreamFormatConverter.h"
 #include "StreamError.h"
 
 // Binary ASCII Converter %b and %B
 
+// 4 bytes of 0 or 1 for each nibble, [0]: msb first, [1]: lsb first
+static unsigned int nibbleBits[2][16];
+// bit reversed bytes
+static unsigned char reversedBits[256];
+
 class BinaryConverter : public StreamFormatConverter
 {
     int parse(const StreamFormat&, StreamBuffer&, const char*&, bool);
     bool printLong(const StreamFormat&, StreamBuffer&, long);
     ssize_t scanLong(const StreamFormat&, const char*, long&);
+    bool printLongArray(const StreamFormat&, StreamBuffer&, const long*, size_t);
+    ssize_t scanLongArray(const StreamFormat&, const char*, size_t, long*, size_t&);
+public:
+    BinaryConverter();
 };
 
+BinaryConverter::
+BinaryConverter()
+{
+    unsigned int i, j;
+    unsigned char bits[4];
+    for (i = 0; i < 16; i++)
+    {
+        for (j = 0; j < 4; j++) bits[j] = (i >> (3-j)) & 1;
+        memcpy(&nibbleBits[0][i], bits, 4);
+        for (j = 0; j < 4; j++) bits[j] = (i >> j) & 1;
+        memcpy(&nibbleBits[1][i], bits, 4);
+    }
+    for (i = 0; i < 256; i++)
+    {
+        reversedBits[i] = 0;
+        for (j = 0; j < 8; j++)
+            if (i & (1 << j)) reversedBits[i] |= 0x80 >> j;
+    }
+}
+
 int BinaryConverter::
 parse(const StreamFormat& fmt, StreamBuffer& info,
     const char*& source, bool)
@@ -62,8 +103,106 @@ parse(const StreamFormat& fmt, StreamBuffer& info,
     return false;
 }
 
-bool BinaryConverter::
-printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
+// Write 8 characters zero or one for the 8 bits of byte.
+struct ExpandTable {
+static inline void expandByte(char* out, unsigned int byte, bool lsbFirst,
+    char zero, char one)
+{
+    // Each byte of the pattern is 0 or 1, thus the multiplications
+    // cannot carry into neighbour bytes.
+    unsigned int x;
+    unsigned int lo = nibbleBits[lsbFirst][byte & 0xf];
+    unsigned int hi = nibbleBits[lsbFirst][byte >> 4];
+    x = lsbFirst ? lo : hi;
+    x = x * (unsigned char)one | (x ^ 0x01010101) * (unsigned char)zero;
+    memcpy(out, &x, 4);
+    x = lsbFirst ? hi : lo;
+    x = x * (unsigned char)one | (x ^ 0x01010101) * (unsigned char)zero;
+    memcpy(out+4, &x, 4);
+}
+};
+
+#ifdef BITS_PDEP
+struct ExpandPdep {
+__attribute__((target("bmi2")))
+static inline void expandByte(char* out, unsigned int byte,
+    bool lsbFirst, char zero, char one)
+{
+    unsigned long long x = _pdep_u64(byte, 0x0101010101010101ULL);
+    if (!lsbFirst) x = __builtin_bswap64(x);
+    x = x * (unsigned char)one | (x ^ 0x0101010101010101ULL) * (unsigned char)zero;
+    memcpy(out, &x, 8);
+}
+};
+#endif
+
+// Write prec characters zero or one for the bits of value.
+// Bits above the size of long are copies of the sign bit.
+template <class Expand>
+static inline void writeBitsWith(char* out, long value, int prec,
+    bool lsbFirst, char zero, char one)
+{
+    const int longbits = sizeof(long) * 8;
+    int i;
+    if (lsbFirst)
+    {
+        // little endian (least significant bit first)
+        unsigned long v = value;
+        int n = prec < longbits ? prec : longbits;
+        for (i = 0; i + 8 <= n; i += 8, v >>= 8)
+            Expand::expandByte(out + i, v & 0xff, true, zero, one);
+        for (; i < prec; i++)
+            out[i] = (i < longbits ? (value >> i) & 1 : value < 0) ? one : zero;
+    }
+    else
+    {
+        // big endian (most significant bit first)
+        for (; prec > longbits; prec--)
+            *out++ = value < 0 ? one : zero;
+        while (prec & 7)
+        {
+            prec--;
+            *out++ = (value >> prec) & 1 ? one : zero;
+        }
+        while (prec)
+        {
+            prec -= 8;
+            Expand::expandByte(out, (value >> prec) & 0xff, false, zero, one);
+            out += 8;
+        }
+    }
+}
+
+typedef void (*WriteBitsFunc)(char*, long, int, bool, char, char);
+
+static void writeBitsTable(char* out, long value, int prec,
+    bool lsbFirst, char zero, char one)
+{
+    writeBitsWith<ExpandTable>(out, value, prec, lsbFirst, zero, one);
+}
+
+#ifdef BITS_PDEP
+// flatten inlines the loop and pdep into this bmi2 function
+__attribute__((target("bmi2"), flatten))
+static void writeBitsPdep(char* out, long value, int prec,
+    bool lsbFirst, char zero, char one)
+{
+    writeBitsWith<ExpandPdep>(out, value, prec, lsbFirst, zero, one);
+}
+#endif
+
+static WriteBitsFunc writeBitsSelect()
+{
+#ifdef BITS_PDEP
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2")) return writeBitsPdep;
+#endif
+    return writeBitsTable;
+}
+
+static const WriteBitsFunc writeBits = writeBitsSelect();
+
+static void printBits(const StreamFormat& fmt, StreamBuffer& output, long value)
 {
     int prec = fmt.prec;
     if (prec == -1)
@@ -82,32 +221,24 @@ printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
     }
     unsigned long width = prec;
     if (fmt.width > width) width = fmt.width;
+    unsigned long pad = width - prec;
     char zero = fmt.info[0];
     char one = fmt.info[1];
     char fill = (fmt.flags & zero_flag) ? zero : ' ';
+    char* out = output.reserve(width);
     if (fmt.flags & alt_flag)
     {
         // little endian (least significant bit first)
         if (!(fmt.flags & left_flag))
         {
             // pad left
-            while (width > (unsigned int)prec)
-            {
-                output.append(' ');
-                width--;
-            }
-        }
-        while (prec--)
-        {
-            output.append((value & 1) ? one : zero);
-            value >>= 1;
-            width--;
-        }
-        while (width--)
-        {
-            // pad right
-            output.append(fill);
+            memset(out, ' ', pad);
+            out += pad;
+            pad = 0;
         }
+        writeBits(out, value, prec, true, zero, one);
+        // pad right
+        memset(out + prec, fill, pad);
     }
     else
     {
@@ -115,59 +246,121 @@ printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
         if (!(fmt.flags & left_flag))
         {
             // pad left
-            while (width > (unsigned int)prec)
-            {
-                output.append(fill);
-                width--;
-            }
-        }
-        while (prec--)
-        {
-            output.append((value & (1L << prec)) ? one : zero);
-            width--;
-        }
-        while (width--)
-        {
-            // pad right
-            output.append(' ');
+            memset(out, fill, pad);
+            out += pad;
+            pad = 0;
         }
+        writeBits(out, value, prec, false, zero, one);
+        // pad right
+        memset(out + prec, ' ', pad);
     }
+}
+
+bool BinaryConverter::
+printLong(const StreamFormat& fmt, StreamBuffer& output, long value)
+{
+    printBits(fmt, output, value);
     return true;
 }
 
-ssize_t BinaryConverter::
-scanLong(const StreamFormat& fmt, const char* input, long& value)
+bool BinaryConverter::
+printLongArray(const StreamFormat& fmt, StreamBuffer& output,
+    const long* values, size_t count)
 {
-    long val = 0;
-    long width = fmt.width;
-    if (width == 0) width = -1;
+    size_t i;
+    for (i = 0; i < count; i++)
+        printBits(fmt, output, values[i]);
+    return true;
+}
+
+// Scan characters zero or one. Vector loads are only used within
+// the first length bytes of input.
+static ssize_t scanBits(const StreamFormat& fmt, const char* input,
+    size_t length, long& value)
+{
+    const size_t longbits = sizeof(long) * 8;
+    unsigned long val = 0;
+    size_t width = fmt.width;
+    if (width == 0) width = (size_t)-1;
     size_t consumed = 0;
+    size_t n = 0;
     char zero = fmt.info[0];
     char one = fmt.info[1];
+    bool lsbFirst = fmt.flags & alt_flag;
     if (!isspace(zero) && !isspace(one))
         while (isspace(input[consumed])) consumed++; // skip whitespaces
     if (input[consumed] != zero && input[consumed] != one) return -1;
-    if (fmt.flags & alt_flag)
+#if defined(__GNUC__) && defined(__SSE2__)
+    const __m128i zeros = _mm_set1_epi8(zero);
+    const __m128i ones = _mm_set1_epi8(one);
+    while (width - n >= 16 && consumed + 16 <= length)
     {
-        // little endian (least significan bit first)
-        long mask = 1;
-        while (width-- && (input[consumed] == zero || input[consumed] == one))
+        __m128i chars = _mm_loadu_si128((const __m128i*)(input + consumed));
+        __m128i isone = _mm_cmpeq_epi8(chars, ones);
+        unsigned int valid = _mm_movemask_epi8(_mm_or_si128(isone,
+            _mm_cmpeq_epi8(chars, zeros)));
+        unsigned int bits = _mm_movemask_epi8(isone);
+        unsigned int k = 16;
+        if (valid != 0xFFFF)
+        {
+            k = __builtin_ctz(~valid);
+            bits &= (1U << k) - 1;
+        }
+        if (lsbFirst)
+        {
+            if (n < longbits) val |= (unsigned long)bits << n;
+        }
+        else if (k)
         {
-            if (input[consumed++] == one) val |= mask;
-            mask <<= 1;
+            bits = reversedBits[bits & 0xff] << 8 | reversedBits[bits >> 8];
+            val = val << k | bits >> (16 - k);
         }
+        n += k;
+        consumed += k;
+        if (k < 16) break;
     }
-    else
+#endif
+    while (n < width && (input[consumed] == zero || input[consumed] == one))
     {
-        // big endian (most significan bit first)
-        while (width-- && (input[consumed] == zero || input[consumed] == one))
+        if (lsbFirst)
         {
+            // little endian (least significant bit first)
+            if (n < longbits && input[consumed] == one) val |= 1UL << n;
+        }
+        else
+        {
+            // big endian (most significant bit first)
             val <<= 1;
-            if (input[consumed++] == one) val |= 1;
+            if (input[consumed] == one) val |= 1;
         }
+        n++;
+        consumed++;
     }
     value = val;
     return consumed;
 }
 
+ssize_t BinaryConverter::
+scanLong(const StreamFormat& fmt, const char* input, long& value)
+{
+    return scanBits(fmt, input, 0, value);
+}
+
+ssize_t BinaryConverter::
+scanLongArray(const StreamFormat& fmt, const char* input, size_t length,
+    long* values, size_t& count)
+{
+    size_t i, consumed = 0;
+    for (i = 0; i < count; i++)
+    {
+        ssize_t size = scanBits(fmt, input + consumed, length - consumed, values[i]);
+        if (size < 0) break;
+        if (fmt.flags & fix_width_flag && (unsigned long)size != fmt.width) break;
+        if ((size_t)size > length - consumed) break;
+        consumed += size;
+    }
+    count = i;
+    return consumed;
+}
+
 RegisterConverter (BinaryConverter, "bB");
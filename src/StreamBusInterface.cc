@@ -127,6 +127,12 @@ readRequest(unsigned long, unsigned long, ssize_t, bool)
     return false;
 }
 
+bool StreamBusInterface::
+coalesceRequest(const void*, size_t, unsigned long)
+{
+    return false;
+}
+
 void StreamBusInterface::
 finish()
 {
@@ -168,3 +174,22 @@ priority()
 {
     return 0;
 }
+
+const char* StreamBusInterface::Client::
+getInPrefixes(size_t& length)
+{
+    length = 0;
+    return NULL;
+}
+
+bool StreamBusInterface::Client::
+inputPending()
+{
+    return false;
+}
+
+unsigned long StreamBusInterface::Client::
+getPollPeriodMax()
+{
+    return 0;
+}
@@ -50,6 +50,9 @@ public:
         virtual long priority();
         virtual const char* getInTerminator(size_t& length) = 0;
         virtual const char* getOutTerminator(size_t& length) = 0;
+        virtual const char* getInPrefixes(size_t& length);
+        virtual bool inputPending();
+        virtual unsigned long getPollPeriodMax();
     public:
         virtual const char* name() = 0;
         virtual ~Client();
@@ -74,6 +77,11 @@ public:
         bool busUnlock() {
             return businterface && businterface->unlock();
         }
+        bool busCoalesceRequest(const void* output, size_t size,
+            unsigned long window_ms) {
+            return businterface && businterface->coalesceRequest(output,
+                    size, window_ms);
+        }
         bool busWriteRequest(const void* output, size_t size,
             unsigned long timeout_ms) {
             return businterface && businterface->writeRequest(output, size, timeout_ms);
@@ -129,6 +137,12 @@ protected:
         { return client->getInTerminator(length); }
     const char* getOutTerminator(size_t& length)
         { return client->getOutTerminator(length); }
+    const char* getInPrefixes(size_t& length)
+        { return client->getInPrefixes(length); }
+    bool inputPending()
+        { return client->inputPending(); }
+    unsigned long getPollPeriodMax()
+        { return client->getPollPeriodMax(); }
     long priority() { return client->priority(); }
     const char* clientName() { return client->name(); }
 
@@ -138,6 +152,8 @@ protected:
     virtual bool readRequest(unsigned long replytimeout_ms,
         unsigned long readtimeout_ms, ssize_t expectedLength,
         bool async);
+    virtual bool coalesceRequest(const void* output, // implement if
+        size_t size, unsigned long window_ms); // queries can be shared
     virtual bool supportsEvent(); // defaults to false
     virtual bool supportsAsyncRead(); // defaults to false
     virtual bool acceptEvent(unsigned long mask, // implement if
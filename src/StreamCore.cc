@@ -29,6 +29,12 @@
 #define Z PRINTF_SIZE_T_PREFIX
 
 int streamErrorDeadTime = 0;
+int streamArrayPrescan = 4096;
+int streamParseThreads = 0;
+int streamParseThreshold = 1000000;
+int streamTraceSize = 0;
+int streamLatencyStats = 0;
+int streamErrorWindow = 0;
 
 /// debug functions /////////////////////////////////////////////
 
@@ -89,12 +95,17 @@ printProtocol(FILE* file)
     fprintf(file, "%s {\n", protocolname());
     fprintf(file, "  extraInput    = %s;\n",
       (flags & IgnoreExtraInput) ? "ignore" : "error");
+    fprintf(file, "  redirectInput = %s;\n",
+      (flags & BatchRedirects) ? "batch" : "immediate");
     fprintf(file, "  lockTimeout   = %ld; # ms\n", lockTimeout);
     fprintf(file, "  readTimeout   = %ld; # ms\n", readTimeout);
     fprintf(file, "  replyTimeout  = %ld; # ms\n", replyTimeout);
     fprintf(file, "  writeTimeout  = %ld; # ms\n", writeTimeout);
     fprintf(file, "  pollPeriod    = %ld; # ms\n", pollPeriod);
+    fprintf(file, "  pollPeriodMax = %ld; # ms\n", pollPeriodMax);
     fprintf(file, "  maxInput      = %ld; # bytes\n", maxInput);
+    fprintf(file, "  coalesceTime  = %ld; # ms\n", coalesceTime);
+    fprintf(file, "  replyCacheTime = %ld; # ms\n", replyCacheTime);
     StreamProtocolParser::printString(buffer.clear(), inTerminator());
     fprintf(file, "  inTerminator  = \"%s\";\n", buffer());
         StreamProtocolParser::printString(buffer.clear(), outTerminator());
@@ -124,10 +135,36 @@ printProtocol(FILE* file)
 
 StreamCore* StreamCore::first = NULL;
 
+// Errors of all records on one port, collapsed over streamErrorWindow.
+// Groups are never freed. Counting is done with lockErrorGroups() held.
+
+struct StreamCore::ErrorGroup
+{
+    enum { Classes = Offline + 1 };
+    ErrorGroup* next;
+    StreamBuffer port;
+    time_t since[Classes];              // start of window
+    unsigned long suppressed[Classes];  // since last summary
+
+    ErrorGroup(const char* name = "") : next(NULL), port(name)
+    {
+        memset(since, 0, sizeof(since));
+        memset(suppressed, 0, sizeof(suppressed));
+    }
+};
+
+StreamCore::ErrorGroup* StreamCore::errorGroups = NULL;
+StreamCore::ErrorGroup StreamCore::allErrors;
+
 StreamCore::
 StreamCore() : StreamBusInterface::Client(),
     next(), streamname(), flags(None), inTerminatorDefined(), outTerminatorDefined(),
-    activeCommand(end), previousResult(Success), numberOfErrors(0), unparsedInput()
+    activeCommand(end), previousResult(Success), numberOfErrors(0),
+    errorGroup(NULL), unparsedInput(),
+    cachedCommand(NULL), cachedTime(0), cacheHits(0), cacheMisses(0), prescanPos(0), prescanNext(0),
+    traceRing(NULL), traceSize(0), traceCount(0),
+    latency(NULL), lockStart(0), writeStart(0), replyStart(0), readStart(0),
+    finishTime(0)
 {
     businterface = NULL;
     // add myself to list of streams
@@ -151,6 +188,8 @@ StreamCore::
             break;
         }
     }
+    delete [] traceRing;
+    delete [] latency;
 }
 
 bool StreamCore::
@@ -164,6 +203,20 @@ attachBus(const char* busname, int addr, const char* param)
             busname, name());
         return false;
     }
+    busName.clear().print("%s", busname);
+    if (addr >= 0) busName.print(" %d", addr);
+    lockErrorGroups();
+    for (errorGroup = errorGroups; errorGroup; errorGroup = errorGroup->next)
+    {
+        if (strcmp(errorGroup->port(), busname) == 0) break;
+    }
+    if (!errorGroup)
+    {
+        errorGroup = new ErrorGroup(busname);
+        errorGroup->next = errorGroups;
+        errorGroups = errorGroup;
+    }
+    releaseErrorGroups();
     debug("StreamCore::attachBus(busname=\"%s\", addr=%i, param=\"%s\") businterface=%p\n",
         busname, addr, param, (void*)businterface);
     return true;
@@ -249,15 +302,21 @@ bool StreamCore::
 compile(StreamProtocolParser::Protocol* protocol)
 {
     const char* extraInputNames [] = {"error", "ignore", NULL};
+    const char* redirectInputNames [] = {"immediate", "batch", NULL};
 
     // default values for protocol variables
-    flags &= ~IgnoreExtraInput;
+    flags &= ~(IgnoreExtraInput|BatchRedirects);
     lockTimeout = 5000;
     readTimeout = 100;
     replyTimeout = 1000;
     writeTimeout = 100;
     maxInput = 0;
     pollPeriod = 1000;
+    pollPeriodMax = 0;
+    coalesceTime = 0;
+    replyCacheTime = 0;
+    cachedOutput.clear();
+    cachedCommand = NULL;
     inTerminatorDefined = false;
     outTerminatorDefined = false;
 
@@ -268,6 +327,13 @@ compile(StreamProtocolParser::Protocol* protocol)
 
     if (ignoreExtraInput) flags |= IgnoreExtraInput;
 
+    unsigned short batchRedirects = false;
+    if (!protocol->getEnumVariable("redirectinput", batchRedirects,
+        redirectInputNames))
+        return false;
+
+    if (batchRedirects) flags |= BatchRedirects;
+
     if (!(protocol->getNumberVariable("locktimeout", lockTimeout) &&
         protocol->getNumberVariable("readtimeout", readTimeout) &&
         protocol->getNumberVariable("replytimeout", replyTimeout) &&
@@ -275,7 +341,10 @@ compile(StreamProtocolParser::Protocol* protocol)
         protocol->getNumberVariable("maxinput", maxInput) &&
         // use replyTimeout as default for pollPeriod
         protocol->getNumberVariable("replytimeout", pollPeriod) &&
-        protocol->getNumberVariable("pollperiod", pollPeriod)))
+        protocol->getNumberVariable("pollperiod", pollPeriod) &&
+        protocol->getNumberVariable("pollperiodmax", pollPeriodMax) &&
+        protocol->getNumberVariable("coalescetime", coalesceTime) &&
+        protocol->getNumberVariable("replycachetime", replyCacheTime)))
         return false;
 
     if (!(protocol->getStringVariable("interminator", inTerminator, &inTerminatorDefined) &&
@@ -295,9 +364,74 @@ compile(StreamProtocolParser::Protocol* protocol)
         protocol->getCommands("@mismatch", onMismatch, this)))
         return false;
 
+    collectInPrefixes();
     return protocol->checkUnused();
 }
 
+void StreamCore::
+collectInPrefixes()
+{
+    // Collect the literal start of all 'in' commands, so that the bus
+    // can pass asynchronous input only to those clients that may match.
+    // code layout:
+    // (length prefix)*
+    // Leave empty (i.e. any input may match) if any 'in' command starts
+    // with something else than a literal or if messages are not
+    // separated by a terminator.
+    StreamBuffer buffer;
+    const char* c = commands();
+    inPrefixes.clear();
+    if (!inTerminator || maxInput) return;
+    while (1)
+    {
+        switch (*c++)
+        {
+            case end:
+                return;
+            case in:
+            {
+                size_t start = inPrefixes.length();
+                size_t length = 0;
+                const char* s = c;
+                inPrefixes.append('\0');
+                while (length < 255)
+                {
+                    if (*s == esc) s++;
+                    else if (*s >= StreamProtocolParser::eos &&
+                        *s < StreamProtocolParser::last_function_code) break;
+                    inPrefixes.append(*s++);
+                    length++;
+                }
+                if (!length)
+                {
+                    inPrefixes.clear();
+                    return;
+                }
+                inPrefixes[start] = (char)length;
+                c = StreamProtocolParser::printString(buffer.clear(), c);
+                break;
+            }
+            case out:
+            case exec:
+                c = StreamProtocolParser::printString(buffer.clear(), c);
+                break;
+            case wait:
+            case connect:
+                extract<unsigned long>(c);
+                break;
+            case event:
+                extract<unsigned long>(c);
+                extract<unsigned long>(c);
+                break;
+            case disconnect:
+                break;
+            default:
+                inPrefixes.clear();
+                return;
+        }
+    }
+}
+
 bool StreamCore::
 compileCommand(StreamProtocolParser::Protocol* protocol,
     StreamBuffer& buffer, const char* command, const char*& args)
@@ -428,6 +562,7 @@ startProtocol(StartMode startMode)
     MutexLock lock(this);
     debug("StreamCore::startProtocol(%s, startMode=%s)\n",
         name(), toStr(startMode));
+    trace(TraceStart, 0, startMode);
     if (!businterface)
     {
         error("%s: No businterface attached\n", name());
@@ -464,6 +599,8 @@ finishProtocol(ProtocolResult status)
 {
     debug("StreamCore::finishProtocol(%s, %s) %sbus owner\n",
         name(), toStr(status), flags & BusOwner ? "" : "not ");
+    trace(TraceFinish, inputLine.length(), status);
+    finishTime = latencyNow();
 
     if (status == Success && flags & BusPending)
     {
@@ -512,7 +649,8 @@ finishProtocol(ProtocolResult status)
                     debug("reparsing input \"%s\"\n",
                         inputLine.expand()());
                     commandIndex = handler + 1;
-                    if (matchInput())
+                    bool matches = matchFinishHook(matchInput());
+                    if (matches)
                     {
                         evalCommand();
                         return;
@@ -541,7 +679,7 @@ finishProtocol(ProtocolResult status)
     if (flags & BusOwner)
     {
         busUnlock();
-        flags &= ~BusOwner;
+        flags &= ~(BusOwner|Coalesced);
     }
     busFinish();
     flags &= ~(AcceptInput|AcceptEvent);
@@ -611,6 +749,27 @@ evalOut()
     }
     outputLine.append(outTerminator);
     debug ("StreamCore::evalOut: outputLine = \"%s\"\n", outputLine.expand()());
+    trace(TraceEvalOut, outputLine.length(), 0);
+    if (replyCacheTime && *commandIndex == in && !(flags & AsyncMode))
+    {
+        if (cachedOutput && cachedCommand == commandIndex &&
+            cachedOutput.length() == outputLine.length() &&
+            cachedOutput.startswith(outputLine(), outputLine.length()) &&
+            getTime() - cachedTime < replyCacheTime)
+        {
+            cacheHits++;
+            // parse the cached reply in timerCallback(),
+            // not synchronously within startProtocol()
+            flags |= WaitPending|CacheHit;
+            startTimer(0);
+            return true;
+        }
+        cacheMisses++;
+        // only keep the reply to this output of this 'in' command
+        cachedOutput.clear();
+        cachedCommand = commandIndex;
+        flags |= CacheReply;
+    }
     if (*commandIndex == in)  // prepare for early input
     {
         flags |= AcceptInput;
@@ -619,11 +778,31 @@ evalOut()
     {
         flags |= AcceptEvent;
     }
+    if (flags & Coalesced)
+    {
+        // previous output was shared with other clients,
+        // but now we need the bus for ourself
+        busUnlock();
+        flags &= ~(BusOwner|Coalesced);
+    }
     if (!(flags & BusOwner))
     {
+        flags |= LockPending;
+        if (coalesceTime && !(flags & (InitRun|AsyncMode)) &&
+            busCoalesceRequest(outputLine(), outputLine.length(),
+                coalesceTime))
+        {
+            // same output is already queued by another client:
+            // continue with lockCallback(), writeCallback() and
+            // readCallback() when the other client gets its reply
+            debug ("StreamCore::evalOut(%s): coalesced\n",
+                name());
+            flags |= Coalesced;
+            return true;
+        }
         debug ("StreamCore::evalOut(%s): lockRequest(%li)\n",
             name(), flags & InitRun ? 0 : lockTimeout);
-        flags |= LockPending;
+        lockStart = latencyNow();
         if (!busLockRequest(flags & InitRun ? 0 : lockTimeout))
         {
             flags &= ~LockPending;
@@ -635,6 +814,7 @@ evalOut()
         return true;
     }
     flags |= WritePending;
+    writeStart = latencyNow();
     if (!busWriteRequest(outputLine(), outputLine.length(), writeTimeout))
     {
         return false;
@@ -692,8 +872,12 @@ normal_format:
 
                 if (fmt.type == pseudo_format)
                 {
-                    if (!StreamFormatConverter::find(fmt.conv)->
-                        printPseudo(fmt, outputLine))
+                    size_t length = outputLine.length();
+                    StreamConverterTimer stats(fmt.conv, false);
+                    bool success = StreamFormatConverter::find(fmt.conv)->
+                        printPseudo(fmt, outputLine);
+                    stats.count(success ? (ssize_t)(outputLine.length() - length) : -1);
+                    if (!success)
                     {
                         error("%s: Can't print pseudo value '%%%s'\n",
                             name(), formatstring);
@@ -768,8 +952,12 @@ printValue(const StreamFormat& fmt, long value)
         return false;
     }
     printSeparator();
-    if (!StreamFormatConverter::find(fmt.conv)->
-        printLong(fmt, outputLine, value))
+    size_t length = outputLine.length();
+    StreamConverterTimer stats(fmt.conv, false);
+    bool success = StreamFormatConverter::find(fmt.conv)->
+        printLong(fmt, outputLine, value);
+    stats.count(success ? (ssize_t)(outputLine.length() - length) : -1);
+    if (!success)
     {
         error("%s: Formatting value %li failed\n",
             name(), value);
@@ -790,8 +978,12 @@ printValue(const StreamFormat& fmt, double value)
         return false;
     }
     printSeparator();
-    if (!StreamFormatConverter::find(fmt.conv)->
-        printDouble(fmt, outputLine, value))
+    size_t length = outputLine.length();
+    StreamConverterTimer stats(fmt.conv, false);
+    bool success = StreamFormatConverter::find(fmt.conv)->
+        printDouble(fmt, outputLine, value);
+    stats.count(success ? (ssize_t)(outputLine.length() - length) : -1);
+    if (!success)
     {
         error("%s: Formatting value %#g failed\n",
             name(), value);
@@ -812,8 +1004,12 @@ printValue(const StreamFormat& fmt, char* value)
         return false;
     }
     printSeparator();
-    if (!StreamFormatConverter::find(fmt.conv)->
-        printString(fmt, outputLine, value))
+    size_t length = outputLine.length();
+    StreamConverterTimer stats(fmt.conv, false);
+    bool success = StreamFormatConverter::find(fmt.conv)->
+        printString(fmt, outputLine, value);
+    stats.count(success ? (ssize_t)(outputLine.length() - length) : -1);
+    if (!success)
     {
         StreamBuffer buffer(value);
         error("%s: Formatting value \"%s\" failed\n",
@@ -825,6 +1021,43 @@ printValue(const StreamFormat& fmt, char* value)
     return true;
 }
 
+bool StreamCore::
+printValues(const StreamFormat& fmt, const long* values, size_t count)
+{
+    if (fmt.type != unsigned_format && fmt.type != signed_format && fmt.type != enum_format)
+    {
+        error("%s: printValues(long*) called with %%%c format\n",
+            name(), fmt.conv);
+        return false;
+    }
+    size_t i;
+    if (separator)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (!printValue(fmt, values[i])) return false;
+        }
+        return true;
+    }
+    // without separator the converter can handle the whole array
+    if (!count) return true;
+    printSeparator();
+    size_t length = outputLine.length();
+    StreamConverterTimer stats(fmt.conv, false);
+    bool success = StreamFormatConverter::find(fmt.conv)->
+        printLongArray(fmt, outputLine, values, count);
+    stats.count(success ? (ssize_t)(outputLine.length() - length) : -1);
+    if (!success)
+    {
+        error("%s: Formatting array of %" Z "u values failed\n",
+            name(), count);
+        return false;
+    }
+    debug("StreamCore::printValues(%s, %%%c, %" Z "u values): \"%s\"\n",
+        name(), fmt.conv, count, outputLine.expand()());
+    return true;
+}
+
 void StreamCore::
 lockCallback(StreamIoStatus status)
 {
@@ -832,6 +1065,7 @@ lockCallback(StreamIoStatus status)
     MutexLock lock(this);
     debug("StreamCore::lockCallback(%s, %s)\n",
         name(), ::toStr(status));
+    trace(TraceLock, 0, status);
     if (!(flags & LockPending))
     {
         error("%s: StreamCore::lockCallback(%s) called unexpectedly\n",
@@ -840,6 +1074,7 @@ lockCallback(StreamIoStatus status)
     }
     flags &= ~LockPending;
     flags |= BusOwner;
+    latencyCount(LatencyLock, lockStart);
     switch (status)
     {
         case StreamIoSuccess:
@@ -851,8 +1086,9 @@ lockCallback(StreamIoStatus status)
             finishProtocol(LockTimeout);
             return;
         case StreamIoFault:
-            error("%s: Locking failed because of a device fault\n",
-                name());
+            if (aggregateError(Fault))
+                error("%s: Locking failed because of a device fault\n",
+                    name());
             flags &= ~BusOwner;
             finishProtocol(LockTimeout);
             return;
@@ -864,6 +1100,7 @@ lockCallback(StreamIoStatus status)
             return;
     }
     flags |= WritePending;
+    writeStart = latencyNow();
     if (!busWriteRequest(outputLine(), outputLine.length(), writeTimeout))
     {
         finishProtocol(Fault);
@@ -877,6 +1114,7 @@ writeCallback(StreamIoStatus status)
     MutexLock lock(this);
     debug("StreamCore::writeCallback(%s, %s)\n",
         name(), ::toStr(status));
+    trace(TraceWrite, outputLine.length(), status);
     if (!(flags & WritePending))
     {
         error("%s: StreamCore::writeCallback(%s) called unexpectedly\n",
@@ -884,6 +1122,7 @@ writeCallback(StreamIoStatus status)
         return;
     }
     flags &= ~WritePending;
+    latencyCount(LatencyWrite, writeStart);
     if (status != StreamIoSuccess)
     {
         finishProtocol(WriteTimeout);
@@ -909,12 +1148,34 @@ getOutTerminator(size_t& length)
 
 // Handle 'in' command
 
+bool StreamCore::
+replyFromCache()
+{
+    // parse cached reply instead of doing I/O
+    debug("StreamCore::replyFromCache(%s): input line: \"%s\"\n",
+        name(), cachedReply.expand()());
+    inputLine = cachedReply;
+    activeCommand = *commandIndex++;
+    clearPrescan();
+    bool matches = matchFinishHook(matchInput());
+    if (!matches)
+    {
+        finishProtocol(ScanError);
+        return false;
+    }
+    return evalCommand();
+}
+
 bool StreamCore::
 evalIn()
 {
     flags |= AcceptInput;
     ssize_t expectedInput;
 
+    clearPrescan();
+    replyStart = latencyNow();
+    readStart = 0;
+
     expectedInput = maxInput;
     if (unparsedInput)
     {
@@ -960,6 +1221,7 @@ readCallback(StreamIoStatus status,
     }
     MutexLock lock(this);
     lastInputStatus = status;
+    trace(TraceRead, size, status);
 
     debug("StreamCore::readCallback(%s, %s input=\"%s\", size=%" Z "u)\n",
         name(), ::toStr(status),
@@ -1004,15 +1266,22 @@ readCallback(StreamIoStatus status,
             finishProtocol(ReplyTimeout);
             return 0;
         case StreamIoFault:
-            error("%s: I/O error after reading %" Z "d byte%s: \"%s%s\"\n",
-                name(),
-                inputBuffer.length(), inputBuffer.length()==1 ? "" : "s",
-                inputBuffer.length() > 20 ? "..." : "",
-                inputBuffer.expand(-20,20)());
+            if (aggregateError(Fault))
+                error("%s: I/O error after reading %" Z "d byte%s: \"%s%s\"\n",
+                    name(),
+                    inputBuffer.length(), inputBuffer.length()==1 ? "" : "s",
+                    inputBuffer.length() > 20 ? "..." : "",
+                    inputBuffer.expand(-20,20)());
             finishProtocol(Fault);
             return 0;
     }
     inputHook(input, size);
+    if (size && !readStart && streamLatencyStats)
+    {
+        // first byte of the reply
+        readStart = getPreciseTime();
+        latencyCount(LatencyReply, replyStart);
+    }
     inputBuffer.append(input, size);
     debug("StreamCore::readCallback(%s) inputBuffer=\"%s\", size %" Z "u\n",
         name(), inputBuffer.expand()(), inputBuffer.length());
@@ -1097,6 +1366,7 @@ readCallback(StreamIoStatus status,
             // input is incomplete - wait for more
             debug("StreamCore::readCallback(%s) wait for more input\n",
                 name());
+            prescanArray();
             flags |= AcceptInput;
             if (maxInput)
                 return maxInput - inputBuffer.length();
@@ -1128,8 +1398,25 @@ readCallback(StreamIoStatus status,
     inputLine.set(inputBuffer(), end);
     debug("StreamCore::readCallback(%s) input line: \"%s\"\n",
         name(), inputLine.expand()());
-    bool matches = matchInput();
+    latencyCount(LatencyRead, readStart);
+    double parseStart = latencyNow();
+    scanArrayParallel();
+    bool matches = matchFinishHook(matchInput());
+    latencyCount(LatencyParse, parseStart);
+    readStart = 0;
+    if (flags & CacheReply)
+    {
+        // only the complete reply to the previous output can be reused
+        if (matches && status != StreamIoTimeout)
+        {
+            cachedOutput = outputLine;
+            cachedReply = inputLine;
+            cachedTime = getTime();
+        }
+        flags &= ~CacheReply;
+    }
     inputBuffer.remove(end + termlen);
+    clearPrescan();
     if (inputBuffer)
     {
         debug("StreamCore::readCallback(%s) unparsed input left: \"%s\"\n",
@@ -1224,6 +1511,7 @@ normal_format:
                     long ldummy;
                     double ddummy;
                     size_t size=0;
+                    StreamConverterTimer stats(fmt.conv, true);
                     switch (fmt.type)
                     {
                         case unsigned_format:
@@ -1261,6 +1549,7 @@ normal_format:
                                 name(), fmt.type);
                             return false;
                     }
+                    stats.count(consumed);
                     if (consumed < 0)
                     {
                         if (fmt.flags & default_flag)
@@ -1269,7 +1558,8 @@ normal_format:
                         }
                         else
                         {
-                            if (!(flags & AsyncMode) && onMismatch[0] != in)
+                            if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                                aggregateError(ScanError))
                             {
                                 error("%s: Input \"%s%s\" does not match format \"%%%s\"\n",
                                     name(), inputLine.expand(consumedInput, 20)(),
@@ -1301,7 +1591,8 @@ normal_format:
                             outputLine.length())(), outputLine.expand()());
                     if (inputLine.length() - consumedInput < outputLine.length())
                     {
-                        if (!(flags & AsyncMode) && onMismatch[0] != in)
+                        if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                            aggregateError(ScanError))
                         {
                             error("%s: Input \"%s%s\" too short."
                                   " No match for format \"%%%s\" (\"%s\")\n",
@@ -1315,7 +1606,8 @@ normal_format:
                     }
                     if (!outputLine.startswith(inputLine(consumedInput),outputLine.length()))
                     {
-                        if (!(flags & AsyncMode) && onMismatch[0] != in)
+                        if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                            aggregateError(ScanError))
                         {
                             error("%s: Input \"%s%s\" does not match format \"%%%s\" (\"%s\")\n",
                                 name(), inputLine.expand(consumedInput, 20)(),
@@ -1331,7 +1623,8 @@ normal_format:
                 flags &= ~Separator;
                 if (!matchValue(fmt, fieldAddress ? fieldAddress() : NULL))
                 {
-                    if (!(flags & AsyncMode) && onMismatch[0] != in)
+                    if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                        aggregateError(ScanError))
                     {
                         if (flags & ScanTried)
                             error("%s: Input \"%s%s\" does not match format \"%%%s\"\n",
@@ -1364,7 +1657,8 @@ normal_format:
                 {
                     int i = 0;
                     while (commandIndex[i] >= ' ') i++;
-                    if (!(flags & AsyncMode) && onMismatch[0] != in)
+                    if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                        aggregateError(ScanError))
                     {
                         error("%s: Input \"%s%s\" too short.\n",
                             name(),
@@ -1377,7 +1671,8 @@ normal_format:
                 }
                 if (command != inputLine[consumedInput])
                 {
-                    if (!(flags & AsyncMode) && onMismatch[0] != in)
+                    if (!(flags & AsyncMode) && onMismatch[0] != in &&
+                        aggregateError(ScanError))
                     {
                         int i = 0;
                         while (commandIndex[i] >= ' ') i++;
@@ -1409,7 +1704,8 @@ normal_format:
     size_t surplus = inputLine.length()-consumedInput;
     if (surplus > 0 && !(flags & IgnoreExtraInput))
     {
-        if (!(flags & AsyncMode) && onMismatch[0] != in)
+        if (!(flags & AsyncMode) && onMismatch[0] != in &&
+            aggregateError(ScanError))
         {
             error("%s: %" Z "d byte%s surplus input \"%s%s\"\n",
                 name(), surplus, surplus==1 ? "" : "s",
@@ -1481,6 +1777,453 @@ matchSeparator()
     return true;
 }
 
+// Long array input arriving in chunks: convert the elements which are
+// already complete (i.e. followed by a complete separator) while waiting
+// for the rest of the line. matchInput() then takes the values from here
+// instead of converting again. Only for 'in' commands which start with
+// literals followed by a numeric format.
+
+int StreamCore::
+arrayStart(const StreamBuffer& input, size_t& pos, StreamFormat& fmt)
+// 1: pos is at the first element
+// 0: input too short to tell
+// -1: the 'in' command is not suitable or does not match
+{
+    // skip literal start of the 'in' command
+    const char* c = commandIndex;
+    char command;
+    pos = 0;
+    while ((command = *c++) != StreamProtocolParser::format)
+    {
+        if (command == StreamProtocolParser::whitespace)
+        {
+            while (pos < input.length() && isspace(input[pos])) pos++;
+            if (pos == input.length()) return 0;
+            continue;
+        }
+        if (command == esc)
+            command = *c++;
+        else if (command >= StreamProtocolParser::eos &&
+            command < StreamProtocolParser::last_function_code)
+        {
+            // field redirection, skip, end of command...
+            return -1;
+        }
+        if (pos == input.length()) return 0;
+        if (input[pos] != command)
+        {
+            // mismatch: matchInput() will tell
+            return -1;
+        }
+        pos++;
+    }
+    StreamBuffer formatstring;
+    c = StreamProtocolParser::printString(formatstring, c);
+    fmt = extract<StreamFormat>(c);
+    fmt.info = c; // same as in matchInput()
+    if (fmt.flags & (skip_flag|compare_flag) ||
+        (fmt.type != signed_format && fmt.type != unsigned_format &&
+            fmt.type != double_format))
+        return -1;
+    return 1;
+}
+
+bool StreamCore::
+arraySeparator(const StreamBuffer& separator, const StreamBuffer& input,
+    size_t& pos)
+{
+    // like matchSeparator() but fails if input is incomplete
+    size_t i;
+    size_t length = input.length();
+    for (i = 0; i < separator.length(); i++)
+    {
+        switch (separator[i])
+        {
+            case StreamProtocolParser::skip:
+                if (pos >= length) return false;
+                pos++;
+                continue;
+            case StreamProtocolParser::whitespace:
+                while (pos < length && isspace(input[pos])) pos++;
+                if (pos >= length) return false;
+                continue;
+            case esc:
+                i++;
+            default:
+                if (pos >= length || separator[i] != input[pos])
+                    return false;
+                pos++;
+        }
+    }
+    return true;
+}
+
+void StreamCore::
+prescanArray()
+{
+    if (prescanPos < 0 || streamArrayPrescan <= 0 || !separator ||
+        maxInput || inputBuffer.length() < (size_t)streamArrayPrescan)
+        return;
+
+    StreamFormat fmt;
+    size_t pos;
+    if (prescanPos == 0)
+    {
+        switch (arrayStart(inputBuffer, pos, fmt))
+        {
+            case 0:
+                return; // try again later
+            case -1:
+                prescanPos = -1;
+                return;
+        }
+        prescanFormat.set(&fmt, sizeof(fmt));
+        prescanned.clear();
+    }
+    else
+    {
+        memcpy(&fmt, prescanFormat(), sizeof(fmt));
+        pos = prescanPos;
+    }
+
+    StreamFormatConverter* converter = StreamFormatConverter::find(fmt.conv);
+    Prescanned entry;
+    size_t count = 0;
+    while (1)
+    {
+        size_t next = pos;
+        if (prescanned && !arraySeparator(separator, inputBuffer, next)) break;
+        entry.offset = next;
+        StreamConverterTimer stats(fmt.conv, true);
+        if (fmt.type == double_format)
+            entry.consumed = converter->scanDouble(fmt,
+                inputBuffer(next), entry.dval);
+        else
+            entry.consumed = converter->scanLong(fmt,
+                inputBuffer(next), entry.lval);
+        stats.count(entry.consumed);
+        if (entry.consumed <= 0) break;
+        next += entry.consumed;
+        // the element may continue in the next chunk
+        // unless the complete separator has already arrived
+        size_t sep = next;
+        if (!arraySeparator(separator, inputBuffer, sep)) break;
+        prescanned.append(&entry, sizeof(entry));
+        count++;
+        pos = next;
+    }
+    if (pos == 0 && !prescanned)
+    {
+        // nothing yet, but literals have matched
+        prescanPos = 0;
+        return;
+    }
+    prescanPos = pos;
+    debug("StreamCore::prescanArray(%s) %" Z "u new, %" Z "u total elements\n",
+        name(), count, prescanned.length()/sizeof(entry));
+}
+
+// Very long array input lines are split at separators into chunks
+// which are converted in parallel (see parallel()).
+// Like with prescanArray(), matchInput() then takes the values from the
+// chunks and converts only what has not been converted already.
+// Thus the result does not depend on where the line was split.
+
+struct StreamCore::ArrayChunk
+{
+    const StreamBuffer* input;
+    const StreamBuffer* separator;
+    StreamFormat fmt;
+    size_t start;           // first element (or its separator)
+    size_t end;             // no element starts here or later
+    bool separatorFirst;
+    StreamBuffer entries;   // Prescanned entries
+};
+
+void StreamCore::
+scanArrayChunk(void* arg)
+{
+    // runs in a worker thread: no debug messages
+    ArrayChunk* chunk = static_cast<ArrayChunk*>(arg);
+    const StreamBuffer& input = *chunk->input;
+    StreamFormatConverter* converter =
+        StreamFormatConverter::find(chunk->fmt.conv);
+    Prescanned entry;
+    size_t pos = chunk->start;
+
+    if (chunk->separatorFirst &&
+        !arraySeparator(*chunk->separator, input, pos))
+        return;
+    while (pos < chunk->end)
+    {
+        entry.offset = pos;
+        if (chunk->fmt.type == double_format)
+            entry.consumed = converter->scanDouble(chunk->fmt,
+                input(pos), entry.dval);
+        else
+            entry.consumed = converter->scanLong(chunk->fmt,
+                input(pos), entry.lval);
+        if (entry.consumed <= 0) break;
+        chunk->entries.append(&entry, sizeof(entry));
+        pos += entry.consumed;
+        if (!arraySeparator(*chunk->separator, input, pos)) break;
+    }
+}
+
+void StreamCore::
+scanArrayParallel()
+{
+    if (streamParseThreads < 2 || streamParseThreshold <= 0 ||
+        !separator || inputLine.length() < (size_t)streamParseThreshold)
+        return;
+
+    StreamFormat fmt;
+    size_t pos;
+    bool separatorFirst = false;
+    if (prescanned)
+    {
+        // continue after the elements converted so far
+        memcpy(&fmt, prescanFormat(), sizeof(fmt));
+        pos = prescanPos;
+        separatorFirst = true;
+    }
+    else
+    {
+        if (arrayStart(inputLine, pos, fmt) <= 0) return;
+        prescanFormat.set(&fmt, sizeof(fmt));
+    }
+
+    size_t n = streamParseThreads;
+    size_t length = inputLine.length();
+    ArrayChunk* chunks = new ArrayChunk[n];
+    void** args = new void*[n];
+    size_t i, count = 0;
+    for (i = 0; i < n; i++)
+    {
+        size_t split = pos + (length - pos) * i / n;
+        bool first = (i == 0);
+        if (!first)
+        {
+            // start after the next separator
+            while (split < length)
+            {
+                size_t next = split;
+                if (arraySeparator(separator, inputLine, next) &&
+                    next > split)
+                {
+                    split = next;
+                    break;
+                }
+                split++;
+            }
+            if (split >= length) break;
+            if (split <= chunks[count-1].start) continue;
+            chunks[count-1].end = split;
+        }
+        chunks[count].input = &inputLine;
+        chunks[count].separator = &separator;
+        chunks[count].fmt = fmt;
+        chunks[count].start = split;
+        chunks[count].end = length;
+        chunks[count].separatorFirst = first && separatorFirst;
+        args[count] = &chunks[count];
+        count++;
+    }
+    StreamConverterTimer stats(fmt.conv, true);
+    parallel(scanArrayChunk, args, count);
+    size_t elements = prescanned.length() / sizeof(Prescanned);
+    for (i = 0; i < count; i++)
+        prescanned.append(chunks[i].entries);
+    stats.count(length - pos);
+    debug("StreamCore::scanArrayParallel(%s) %" Z "u chunks, %" Z "u elements\n",
+        name(), count, prescanned.length() / sizeof(Prescanned) - elements);
+    delete[] args;
+    delete[] chunks;
+}
+
+void StreamCore::
+parallel(void (*job)(void*), void* args[], size_t count)
+{
+    // no threads here, see Stream::parallel()
+    size_t i;
+    for (i = 0; i < count; i++)
+        job(args[i]);
+}
+
+bool StreamCore::
+prescannedValue(const StreamFormat& fmt, long* lval, double* dval,
+    ssize_t& consumed)
+{
+    if (!prescanned) return false;
+    StreamFormat pfmt;
+    memcpy(&pfmt, prescanFormat(), sizeof(pfmt));
+    if (fmt.info != pfmt.info) return false; // other format
+    Prescanned entry;
+    size_t count = prescanned.length()/sizeof(entry);
+    for (; prescanNext < count; prescanNext++)
+    {
+        memcpy(&entry, prescanned(prescanNext*sizeof(entry)), sizeof(entry));
+        if (entry.offset >= consumedInput) break;
+    }
+    if (prescanNext == count || entry.offset != consumedInput) return false;
+    prescanNext++;
+    consumed = entry.consumed;
+    if (lval) *lval = entry.lval;
+    if (dval) *dval = entry.dval;
+    return true;
+}
+
+void StreamCore::
+clearPrescan()
+{
+    prescanned.clear();
+    prescanPos = 0;
+    prescanNext = 0;
+}
+
+void StreamCore::
+traceEvent(TraceEvent event, size_t bytes, int status)
+{
+    // Called with the mutex locked, thus each ring has only one writer.
+    if (traceSize != (size_t)streamTraceSize)
+    {
+        delete [] traceRing;
+        traceRing = new TraceEntry[streamTraceSize];
+        traceSize = streamTraceSize;
+        traceCount = 0;
+    }
+    TraceEntry& entry = traceRing[traceCount % traceSize];
+    entry.ticks = StreamFormatConverter::ticks();
+    entry.time = getTime();
+    entry.bytes = (unsigned long)bytes;
+    entry.event = (unsigned char)event;
+    entry.status = (unsigned char)status;
+    traceCount++;
+}
+
+void StreamCore::
+printTrace(StreamBuffer& buffer)
+{
+    MutexLock lock(this);
+    unsigned long i = traceCount > traceSize ? traceCount - traceSize : 0;
+    if (i == traceCount)
+    {
+        buffer.print("  no trace\n");
+        return;
+    }
+    TraceEntry& start = traceRing[i % traceSize];
+    buffer.print("  trace: %lu of %lu events\n"
+        "      ms        ticks event     bytes status\n",
+        traceCount - i, traceCount);
+    for (; i < traceCount; i++)
+    {
+        TraceEntry& entry = traceRing[i % traceSize];
+        const char* status = "";
+        switch (entry.event)
+        {
+            case TraceStart:
+                status = toStr((StartMode)entry.status);
+                break;
+            case TraceLock:
+            case TraceWrite:
+            case TraceRead:
+                status = ::toStr((StreamIoStatus)entry.status);
+                break;
+            case TraceFinish:
+                status = toStr((ProtocolResult)entry.status);
+                break;
+        }
+        buffer.print("  %6lu %12.0f %-8s %6lu %s\n",
+            entry.time - start.time, (double)(entry.ticks - start.ticks),
+            toStr((TraceEvent)entry.event) + 5, // skip "Trace"
+            entry.bytes, status);
+    }
+}
+
+double StreamCore::
+getPreciseTime()
+{
+    return getTime() * 0.001;
+}
+
+void StreamCore::
+latencyCount(LatencyPhase phase, double start)
+{
+    if (!streamLatencyStats || start <= 0) return;
+    if (!latency)
+    {
+        latency = new LatencyHistograms[1];
+        resetLatency();
+    }
+    double us = (getPreciseTime() - start) * 1e6;
+    int bucket = 0;
+    while (us >= 2 && bucket < LatencyBuckets - 1)
+    {
+        us *= 0.5;
+        bucket++;
+    }
+    (*latency)[phase][bucket]++;
+}
+
+void StreamCore::
+resetLatency()
+{
+    if (latency) memset(latency, 0, sizeof(LatencyHistograms));
+}
+
+void StreamCore::
+addLatency(LatencyHistograms& sum)
+{
+    int phase, bucket;
+    if (!latency) return;
+    for (phase = 0; phase < LatencyPhases; phase++)
+        for (bucket = 0; bucket < LatencyBuckets; bucket++)
+            sum[phase][bucket] += (*latency)[phase][bucket];
+}
+
+void StreamCore::
+printLatency(StreamBuffer& buffer)
+{
+    if (!latency)
+    {
+        buffer.print("  no latency statistics\n");
+        return;
+    }
+    printLatency(buffer, *latency);
+}
+
+void StreamCore::
+printLatency(StreamBuffer& buffer, const LatencyHistograms& histograms)
+{
+    // Percentiles are upper limits of the histogram buckets.
+    static const double percent[] = {50, 90, 99, 100};
+    int phase, bucket, p;
+    buffer.print("  phase         count       p50       p90       p99       max"
+        " (us, bucket limits)\n");
+    for (phase = 0; phase < LatencyPhases; phase++)
+    {
+        const unsigned long* histogram = histograms[phase];
+        unsigned long count = 0, sum;
+        for (bucket = 0; bucket < LatencyBuckets; bucket++)
+            count += histogram[bucket];
+        buffer.print("  %-8s %10lu", toStr((LatencyPhase)phase) + 7, count);
+        for (p = 0; p < 4 && count; p++)
+        {
+            sum = 0;
+            for (bucket = 0; bucket < LatencyBuckets - 1; bucket++)
+            {
+                sum += histogram[bucket];
+                if (sum * 100.0 >= count * percent[p]) break;
+            }
+            if (bucket == LatencyBuckets - 1)
+                buffer.print(" %8lu+", 1UL << bucket);
+            else
+                buffer.print(" %9lu", 2UL << bucket);
+        }
+        buffer.append('\n');
+    }
+}
+
 ssize_t StreamCore::
 scanValue(const StreamFormat& fmt, long& value)
 {
@@ -1492,8 +2235,14 @@ scanValue(const StreamFormat& fmt, long& value)
     }
     flags |= ScanTried;
     if (!matchSeparator()) return -1;
-    ssize_t consumed = StreamFormatConverter::find(fmt.conv)->
-        scanLong(fmt, inputLine(consumedInput), value);
+    ssize_t consumed;
+    if (!prescannedValue(fmt, &value, NULL, consumed))
+    {
+        StreamConverterTimer stats(fmt.conv, true);
+        consumed = StreamFormatConverter::find(fmt.conv)->
+            scanLong(fmt, inputLine(consumedInput), value);
+        stats.count(consumed);
+    }
     if (consumed < 0)
     {
         debug("StreamCore::scanValue(%s, format=%%%c, long) input=\"%s\" failed\\n",
@@ -1513,6 +2262,51 @@ scanValue(const StreamFormat& fmt, long& value)
     return consumed;
 }
 
+ssize_t StreamCore::
+scanValues(const StreamFormat& fmt, long* values, size_t& count)
+{
+    if (fmt.type != unsigned_format && fmt.type != signed_format && fmt.type != enum_format)
+    {
+        error("%s: scanValues(long*) called with %%%c format\n",
+            name(), fmt.conv);
+        return -1;
+    }
+    size_t i;
+    ssize_t consumed;
+    if (separator || fmt.flags & default_flag)
+    {
+        // element by element
+        size_t start = consumedInput;
+        for (i = 0; i < count; i++)
+        {
+            consumed = scanValue(fmt, values[i]);
+            if (consumed < 0) break;
+            consumedInput += consumed;
+        }
+        consumed = consumedInput - start;
+        consumedInput = start;
+        count = i;
+        return i ? consumed : -1;
+    }
+    // without separator the converter can handle the whole array
+    flags |= ScanTried|Separator;
+    StreamConverterTimer stats(fmt.conv, true);
+    consumed = StreamFormatConverter::find(fmt.conv)->
+        scanLongArray(fmt, inputLine(consumedInput),
+            inputLine.length()-consumedInput, values, count);
+    stats.count(count ? consumed : -1);
+    if (!count)
+    {
+        debug("StreamCore::scanValues(%s, format=%%%c, long*) input=\"%s\" failed\n",
+            name(), fmt.conv, inputLine.expand(consumedInput)());
+        return -1;
+    }
+    debug("StreamCore::scanValues(%s, format=%%%c, long*) input=\"%s\" %" Z "u values\n",
+        name(), fmt.conv, inputLine.expand(consumedInput, consumed)(), count);
+    flags |= GotValue;
+    return consumed;
+}
+
 ssize_t StreamCore::
 scanValue(const StreamFormat& fmt, double& value)
 {
@@ -1524,8 +2318,14 @@ scanValue(const StreamFormat& fmt, double& value)
     }
     flags |= ScanTried;
     if (!matchSeparator()) return -1;
-    ssize_t consumed = StreamFormatConverter::find(fmt.conv)->
-        scanDouble(fmt, inputLine(consumedInput), value);
+    ssize_t consumed;
+    if (!prescannedValue(fmt, NULL, &value, consumed))
+    {
+        StreamConverterTimer stats(fmt.conv, true);
+        consumed = StreamFormatConverter::find(fmt.conv)->
+            scanDouble(fmt, inputLine(consumedInput), value);
+        stats.count(consumed);
+    }
     if (consumed < 0)
     {
         debug("StreamCore::scanValue(%s, format=%%%c, double) input=\"%s\" failed\n",
@@ -1556,8 +2356,10 @@ scanValue(const StreamFormat& fmt, char* value, size_t& size)
     }
     flags |= ScanTried;
     if (!matchSeparator()) return -1;
+    StreamConverterTimer stats(fmt.conv, true);
     ssize_t consumed = StreamFormatConverter::find(fmt.conv)->
         scanString(fmt, inputLine(consumedInput), value, size);
+    stats.count(consumed);
     if (consumed < 0)
     {
         debug("StreamCore::scanValue(%s, format=%%%c, char*, size=%" Z "d) input=\"%s\" failed\n",
@@ -1593,6 +2395,25 @@ getInTerminator(size_t& length)
     }
 }
 
+const char* StreamCore::
+getInPrefixes(size_t& length)
+{
+    length = inPrefixes.length();
+    return length ? inPrefixes() : NULL;
+}
+
+bool StreamCore::
+inputPending()
+{
+    return unparsedInput;
+}
+
+unsigned long StreamCore::
+getPollPeriodMax()
+{
+    return pollPeriodMax;
+}
+
 // Handle 'event' command
 
 bool StreamCore::
@@ -1671,6 +2492,12 @@ timerCallback()
         return;
     }
     flags &= ~WaitPending;
+    if (flags & CacheHit)
+    {
+        flags &= ~CacheHit;
+        replyFromCache();
+        return;
+    }
     evalCommand();
 }
 
@@ -1812,6 +2639,7 @@ printStatus(StreamBuffer& buffer)
         activeCommand ? CommandsToStr(activeCommand) : "none");
     buffer.print("flags=0x%04lx", flags);
     if (flags & IgnoreExtraInput) buffer.append(" IgnoreExtraInput");
+    if (flags & BatchRedirects)   buffer.append(" BatchRedirects");
     if (flags & InitRun)          buffer.append(" InitRun");
     if (flags & AsyncMode)        buffer.append(" AsyncMode");
     if (flags & GotValue)         buffer.append(" GotValue");
@@ -1824,6 +2652,12 @@ printStatus(StreamBuffer& buffer)
     if (flags & WritePending)     buffer.append(" WritePending");
     if (flags & WaitPending)      buffer.append(" WaitPending");
     if (flags & Aborted)          buffer.append(" Aborted");
+    if (flags & Coalesced)        buffer.append(" Coalesced");
+    if (flags & CacheReply)       buffer.append(" CacheReply");
+    if (flags & CacheHit)         buffer.append(" CacheHit");
+    if (replyCacheTime)
+        buffer.print(" reply cache hits=%lu misses=%lu",
+            cacheHits, cacheMisses);
     busPrintStatus(buffer);
 }
 
@@ -1857,25 +2691,109 @@ license(void)
  */
 bool  StreamCore::checkShouldPrint(ProtocolResult newErrorType)
 {
+    int additionalErrors = 0;
     if (previousResult != newErrorType) {
         previousResult = newErrorType;
         numberOfErrors = 0;
         time(&lastErrorTime);
-        return true;
     }
     else if ((int)(time(NULL) - lastErrorTime) > streamErrorDeadTime) {
         time(&lastErrorTime);
-        if (numberOfErrors != 0) {
-            error("%s: %i additional errors of the following type seen in the last %i seconds\n",
-                name(), numberOfErrors, streamErrorDeadTime);
-        }
+        additionalErrors = numberOfErrors;
         numberOfErrors = 0;
-        return true;
     }
     else {
         numberOfErrors++;
         return false;
     }
+    // streamErrorWindow may still suppress the message
+    if (!aggregateError(newErrorType)) {
+        numberOfErrors += additionalErrors;
+        return false;
+    }
+    if (additionalErrors != 0) {
+        error("%s: %i additional errors of the following type seen in the last %i seconds\n",
+            name(), additionalErrors, streamErrorDeadTime);
+    }
+    return true;
+}
+
+bool  StreamCore::aggregateError(ProtocolResult newErrorType)
+{
+    if (streamErrorWindow <= 0 || !errorGroup) return true;
+    bool print = true;
+    bool firstSuppressed = false;
+    StreamBuffer summaries;
+    time_t now = time(NULL);
+    lockErrorGroups();
+    collectErrorSummaries(now, summaries);
+    if ((int)(now - errorGroup->since[newErrorType]) > streamErrorWindow)
+    {
+        // first error of this type on this port in the window
+        errorGroup->since[newErrorType] = now;
+    }
+    else
+    {
+        if (allErrors.suppressed[newErrorType]++ == 0)
+        {
+            allErrors.since[newErrorType] = now;
+            firstSuppressed = true;
+        }
+        errorGroup->suppressed[newErrorType]++;
+        print = false;
+    }
+    releaseErrorGroups();
+    // print outside the lock
+    if (summaries) error("%s", summaries());
+    // summary even if no further error comes
+    if (firstSuppressed) startErrorTimer(streamErrorWindow + 1);
+    return print;
+}
+
+// Called from the timer started in aggregateError().
+void StreamCore::
+flushErrorSummaries()
+{
+    StreamBuffer summaries;
+    lockErrorGroups();
+    double next = collectErrorSummaries(time(NULL), summaries);
+    releaseErrorGroups();
+    if (summaries) error("%s", summaries());
+    if (next > 0) startErrorTimer(next);
+}
+
+// Append summary lines for all error classes whose window has elapsed
+// and return the seconds until the next summary is due (0 if none).
+// Call with lockErrorGroups() held.
+double StreamCore::
+collectErrorSummaries(time_t now, StreamBuffer& summaries)
+{
+    double next = 0;
+    int e;
+    for (e = 0; e < ErrorGroup::Classes; e++)
+    {
+        if (!allErrors.suppressed[e]) continue;
+        int age = (int)(now - allErrors.since[e]);
+        if (age <= streamErrorWindow)
+        {
+            double due = streamErrorWindow + 1 - age;
+            if (next == 0 || due < next) next = due;
+            continue;
+        }
+        StreamBuffer ports;
+        for (ErrorGroup* group = errorGroups; group; group = group->next)
+        {
+            if (!group->suppressed[e]) continue;
+            ports.print("%s%s (%lu)", ports ? ", " : "",
+                group->port(), group->suppressed[e]);
+            group->suppressed[e] = 0;
+        }
+        summaries.print("%lu %s errors suppressed in the last %i seconds on %s\n",
+            allErrors.suppressed[e], toStr((ProtocolResult)e),
+            streamErrorWindow, ports());
+        allErrors.suppressed[e] = 0;
+    }
+    return next;
 }
 
 #include "streamReferences"
@@ -47,6 +47,7 @@ bool formatValue(const StreamFormat& format, const void* fieldaddress)
   The printValue(format,XXX) function suitable for format.type should be
   called to print value. If value is an array, printValue() should be called
   for each element. The separator string will be added automatically.
+  Arrays of long values should be printed with printValues() at once.
   formatValue() must return true on success and false on failure.
 
 bool matchValue(const StreamFormat& format, const void* fieldaddress)
@@ -57,6 +58,7 @@ bool matchValue(const StreamFormat& format, const void* fieldaddress)
   If value is an array, scanValue() should be called for each element. It
   returns false if there is no more element available. The separator string
   is matched automatically.
+  Arrays of long values should be scanned with scanValues() at once.
   matchValue() must return true on success and false on failure.
 
 
@@ -84,20 +86,44 @@ const unsigned long GotValue         = 0x0008;
 const unsigned long BusOwner         = 0x0010;
 const unsigned long Separator        = 0x0020;
 const unsigned long ScanTried        = 0x0040;
+const unsigned long BatchRedirects   = 0x0080;
 const unsigned long AcceptInput      = 0x0100;
 const unsigned long AcceptEvent      = 0x0200;
 const unsigned long LockPending      = 0x0400;
 const unsigned long WritePending     = 0x0800;
 const unsigned long WaitPending      = 0x1000;
 const unsigned long Aborted          = 0x2000;
+const unsigned long Coalesced        = 0x4000;
+const unsigned long CacheReply       = 0x8000;
+const unsigned long CacheHit         = 0x10000;
 const unsigned long BusPending       = LockPending|WritePending|WaitPending;
 const unsigned long ClearOnStart     = InitRun|AsyncMode|GotValue|Aborted|
                                        BusOwner|Separator|ScanTried|
-                                       AcceptInput|AcceptEvent|BusPending;
+                                       AcceptInput|AcceptEvent|BusPending|
+                                       Coalesced|CacheReply|CacheHit;
 
 // The amount of time to wait before printing duplicated messages
 extern int streamErrorDeadTime;
 
+// Size of an incomplete input line from which on array elements are
+// converted while the rest of the line is still arriving (0: never)
+extern int streamArrayPrescan;
+
+// Number of threads converting array input lines longer than
+// streamParseThreshold bytes in parallel (< 2: no parallel conversion)
+extern int streamParseThreads;
+extern int streamParseThreshold;
+
+// Number of binary trace entries kept per record (0: no trace)
+extern int streamTraceSize;
+
+// Collect histograms of protocol phase durations per record (0: off)
+extern int streamLatencyStats;
+
+// Seconds over which identical errors of all records on one port are
+// collapsed into one summary line (0: off)
+extern int streamErrorWindow;
+
 struct StreamFormat;
 
 class StreamCore :
@@ -115,6 +141,13 @@ protected:
     ENUM (Commands,
         end, in, out, wait, event, exec, connect, disconnect);
 
+    ENUM (TraceEvent,
+        TraceStart, TraceEvalOut, TraceLock, TraceWrite, TraceRead, TraceFinish);
+
+    ENUM (LatencyPhase,
+        LatencyLock, LatencyWrite, LatencyReply, LatencyRead, LatencyParse,
+        LatencyProcess);
+
     class MutexLock
     {
         StreamCore* stream;
@@ -144,10 +177,12 @@ protected:
     bool printValue(const StreamFormat& format, long value);
     bool printValue(const StreamFormat& format, double value);
     bool printValue(const StreamFormat& format, char* value);
+    bool printValues(const StreamFormat& format, const long* values, size_t count);
     ssize_t scanValue(const StreamFormat& format, long& value);
     ssize_t scanValue(const StreamFormat& format, double& value);
     ssize_t scanValue(const StreamFormat& format, char* value, size_t& size);
     ssize_t scanValue(const StreamFormat& format);
+    ssize_t scanValues(const StreamFormat& format, long* values, size_t& count);
 
     StreamBuffer protocolname;
     unsigned long lockTimeout;
@@ -155,7 +190,10 @@ protected:
     unsigned long replyTimeout;
     unsigned long readTimeout;
     unsigned long pollPeriod;
+    unsigned long pollPeriodMax;
     unsigned long maxInput;
+    unsigned long coalesceTime;
+    unsigned long replyCacheTime;
     bool inTerminatorDefined;
     bool outTerminatorDefined;
     StreamBuffer inTerminator;
@@ -167,6 +205,7 @@ protected:
     StreamBuffer onReplyTimeout;  // error handler (optional)
     StreamBuffer onReadTimeout;   // error handler (optional)
     StreamBuffer onMismatch;      // error handler (optional)
+    StreamBuffer inPrefixes;      // literal prefixes of 'in' commands
     const char* commandIndex;     // current position
     char activeCommand;           // current command
     StreamBuffer outputLine;
@@ -180,10 +219,64 @@ protected:
     ProtocolResult previousResult;
     time_t lastErrorTime;
     int numberOfErrors;
+    struct ErrorGroup;
+    static ErrorGroup* errorGroups;
+    static ErrorGroup allErrors;
+    ErrorGroup* errorGroup;       // errors of all records on the same port
 
     StreamIoStatus lastInputStatus;
     bool unparsedInput;
 
+    // Reply of last output, reused for replyCacheTime
+    StreamBuffer cachedOutput;
+    StreamBuffer cachedReply;
+    const char* cachedCommand;    // the 'in' command which got the reply
+    unsigned long cachedTime;
+    unsigned long cacheHits;
+    unsigned long cacheMisses;
+
+    // Array elements converted before the input line was complete
+    struct Prescanned
+    {
+        size_t offset;      // in inputLine (after separator)
+        ssize_t consumed;
+        long lval;
+        double dval;
+    };
+    StreamBuffer prescanned;      // Prescanned entries
+    StreamBuffer prescanFormat;   // StreamFormat of the elements
+    ssize_t prescanPos;           // next separator, 0: not yet, -1: never
+    size_t prescanNext;           // next entry to use
+
+    // Binary trace of protocol execution, written with mutex locked
+    struct TraceEntry
+    {
+        StreamTicks ticks;
+        unsigned long time;
+        unsigned long bytes;
+        unsigned char event;      // TraceEvent
+        unsigned char status;     // StartMode, StreamIoStatus or ProtocolResult
+    };
+    TraceEntry* traceRing;
+    size_t traceSize;             // entries in traceRing
+    unsigned long traceCount;     // entries written so far
+    void trace(TraceEvent event, size_t bytes, int status)
+        { if (streamTraceSize > 0) traceEvent(event, bytes, status); }
+
+    // Histograms of protocol phase durations in log2 microsecond buckets
+    enum { LatencyPhases = LatencyProcess + 1, LatencyBuckets = 24 };
+    typedef unsigned long LatencyHistograms[LatencyPhases][LatencyBuckets];
+    LatencyHistograms* latency;
+    double lockStart;
+    double writeStart;
+    double replyStart;
+    double readStart;             // 0: no input byte yet
+    double finishTime;
+    StreamBuffer busName;
+    double latencyNow()
+        { return streamLatencyStats ? getPreciseTime() : 0; }
+    void latencyCount(LatencyPhase phase, double start);
+
     StreamCore(const StreamCore&); // undefined
     bool compile(StreamProtocolParser::Protocol*);
     bool evalCommand();
@@ -216,17 +309,30 @@ protected:
     void disconnectCallback(StreamIoStatus status);
     const char* getInTerminator(size_t& length);
     const char* getOutTerminator(size_t& length);
+    const char* getInPrefixes(size_t& length);
+    bool inputPending();
+    unsigned long getPollPeriodMax();
 
 // virtual methods
     virtual void protocolStartHook() {}
     virtual void inputHook(const void* input, size_t size) {};
     virtual void protocolFinishHook(ProtocolResult) {}
+    // returns false if writing the matched values failed
+    virtual bool matchFinishHook(bool matches) { return matches; }
     virtual void startTimer(unsigned long timeout) = 0;
+    virtual unsigned long getTime() = 0; // milliseconds
+    virtual double getPreciseTime(); // seconds
+    virtual void parallel(void (*job)(void*), void* args[], size_t count);
     virtual bool formatValue(const StreamFormat&, const void* fieldaddress) = 0;
     virtual bool matchValue (const StreamFormat&, const void* fieldaddress) = 0;
     virtual void lockMutex() = 0;
     virtual void releaseMutex() = 0;
+    virtual void lockErrorGroups() {} // one lock for all streams
+    virtual void releaseErrorGroups() {}
+    // call flushErrorSummaries() after delay seconds (streamErrorWindow)
+    virtual void startErrorTimer(double delay) {}
     virtual bool execute();
+    void flushErrorSummaries();
 
 public:
     StreamCore();
@@ -235,11 +341,33 @@ public:
     void printProtocol(FILE* = stdout);
     const char* name() { return streamname; }
     void printStatus(StreamBuffer& buffer);
+    void printTrace(StreamBuffer& buffer);
+    void printLatency(StreamBuffer& buffer);
+    void addLatency(LatencyHistograms& sum);
+    void resetLatency();
+    static void printLatency(StreamBuffer& buffer,
+        const LatencyHistograms& histograms);
+    const char* bus() { return busName(); }
     static const char* license(void);
 
 private:
     char* printCommands(StreamBuffer& buffer, const char* c);
+    void collectInPrefixes();
+    bool replyFromCache();
+    struct ArrayChunk;
+    int arrayStart(const StreamBuffer& input, size_t& pos, StreamFormat& fmt);
+    static bool arraySeparator(const StreamBuffer& separator,
+        const StreamBuffer& input, size_t& pos);
+    void prescanArray();
+    static void scanArrayChunk(void* chunk);
+    void scanArrayParallel();
+    bool prescannedValue(const StreamFormat& fmt,
+        long* lval, double* dval, ssize_t& consumed);
+    void clearPrescan();
+    void traceEvent(TraceEvent event, size_t bytes, int status);
     bool  checkShouldPrint(ProtocolResult newErrorType);
+    bool  aggregateError(ProtocolResult newErrorType);
+    static double collectErrorSummaries(time_t now, StreamBuffer& summaries);
 };
 
 #endif
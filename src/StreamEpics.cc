@@ -63,6 +63,7 @@ extern "C" epicsShareFunc int epicsShareAPI iocshCmd(const char *command);
 
 #include "StreamCore.h"
 #include "StreamError.h"
+#include "StreamTimerWheel.h"
 #include "devStream.h"
 
 #define Z PRINTF_SIZE_T_PREFIX
@@ -71,6 +72,16 @@ extern "C" epicsShareFunc int epicsShareAPI iocshCmd(const char *command);
 #define WITH_IOC_RUN
 #endif
 
+#if defined(VERSION_INT) && EPICS_VERSION_INT >= VERSION_INT(3,16,1,0)
+// Older waveform and aai records do not refresh pfield in get_array_info,
+// thus channels would keep the old buffer after swapping bptr.
+#define WITH_SHADOW_BUFFER
+#endif
+
+#if defined(VERSION_INT) && EPICS_VERSION_INT >= VERSION_INT(3,16,1,0)
+#define WITH_MONOTONIC_TIME
+#endif
+
 // More flags: 0x00FFFFFF used by StreamCore
 const unsigned long InDestructor  = 0x0100000;
 const unsigned long ValueReceived = 0x0200000;
@@ -78,21 +89,40 @@ const unsigned long ValueReceived = 0x0200000;
 extern "C" {
 long streamReload(const char* recordname);
 long streamReportRecord(const char* recordname);
+long streamReportConverters(int reset);
+long streamReportTrace(const char* recordname);
+long streamReportLatency(const char* recordname, int reset);
 }
 
 class Stream : protected StreamCore, epicsTimerNotify
 {
+    struct Redirect
+    {
+        DBADDR addr;
+        long nord;
+        size_t size;
+        short type;
+    };
+
     dbCommon* record;
     const struct link *ioLink;
     streamIoFunction readData;
     streamIoFunction writeData;
     epicsTimerQueueActive* timerQueue;
     epicsTimer* timer;
+    StreamPortTimer* portTimer;   // instead of timer (streamTimerWheel)
     epicsMutex mutex;
     epicsEvent initDone;
     int status;
     int convert;
     ssize_t currentValueLength;
+    long* arrayValues;
+    size_t arraySize;
+    void* shadowBuffer;           // second array buffer (streamDoubleBuffer)
+    void** swapBptr;              // record buffer to exchange when processed
+    epicsUInt32* swapNord;
+    epicsUInt32 swapCount;
+    StreamBuffer redirects;       // values for other records (batched)
     IOSCANPVT ioscanpvt;
     CALLBACK commandCallback;
     CALLBACK processCallback;
@@ -103,7 +133,11 @@ class Stream : protected StreamCore, epicsTimerNotify
 // StreamCore methods
     void inputHook(const void* input, size_t size);
     void protocolFinishHook(ProtocolResult);
+    bool matchFinishHook(bool matches);
     void startTimer(unsigned long timeout);
+    unsigned long getTime();
+    double getPreciseTime();
+    void parallel(void (*job)(void*), void* args[], size_t count);
     bool getFieldAddress(const char* fieldname,
         StreamBuffer& address);
     bool formatValue(const StreamFormat&,
@@ -112,6 +146,9 @@ class Stream : protected StreamCore, epicsTimerNotify
         const void* fieldaddress);
     void lockMutex();
     void releaseMutex();
+    void lockErrorGroups();
+    void releaseErrorGroups();
+    void startErrorTimer(double delay);
     bool execute();
 
 // need static wrappers for callbacks
@@ -132,9 +169,28 @@ class Stream : protected StreamCore, epicsTimerNotify
     long initRecord(char* linkstring);
     bool print(format_t *format, va_list ap);
     ssize_t scan(format_t *format, void* pvalue, size_t maxStringSize);
+    bool printArray(format_t *format, const void* values,
+        unsigned short ftvl, size_t count);
+    ssize_t scanArray(format_t *format, void* values,
+        unsigned short ftvl, size_t maxElements);
+    long* reserveArray(size_t count);
+    bool printDoubleArray(const StreamFormat& format, const void* values,
+        unsigned short ftvl, size_t count);
+    ssize_t scanDoubleArray(const StreamFormat& format, void* values,
+        unsigned short ftvl, size_t maxElements);
+    bool scanNextValue(const StreamFormat& format, double& value);
+    int formatArrayField(const StreamFormat& format, DBADDR* pdbaddr);
+    bool printFieldValues(const StreamFormat& format, const DBADDR* pdbaddr,
+        long first, long last);
+    int matchArrayField(const StreamFormat& format, DBADDR* pdbaddr,
+        short type);
     bool process();
+    void swapBuffer();
+    void freeShadowBuffer();
     static void initHook(initHookState);
 
+    friend class StreamErrorTimer;
+
 // device support functions
     friend long streamInitRecord(dbCommon *record, const struct link *ioLink,
         streamIoFunction readData, streamIoFunction writeData);
@@ -144,8 +200,17 @@ class Stream : protected StreamCore, epicsTimerNotify
     friend long streamPrintf(dbCommon *record, format_t *format, ...);
     friend ssize_t streamScanfN(dbCommon *record, format_t *format,
         void*, size_t maxStringSize);
+    friend long streamPrintfArray(dbCommon *record, format_t *format,
+        const void* values, unsigned short ftvl, size_t count);
+    friend ssize_t streamScanfArray(dbCommon *record, format_t *format,
+        void* values, unsigned short ftvl, size_t maxElements);
+    friend void* streamShadowBuffer(dbCommon *record, size_t size);
+    friend void streamSwapBuffer(dbCommon *record, void** bptr,
+        epicsUInt32* nord, epicsUInt32 count);
     friend long streamReload(const char* recordname);
     friend long streamReportRecord(const char* recordname);
+    friend long streamReportTrace(const char* recordname);
+    friend long streamReportLatency(const char* recordname, int reset);
 
 public:
     long priority() { return record->prio; };
@@ -153,6 +218,134 @@ public:
     static long drvInit();
 };
 
+// Worker threads shared by all records for Stream::parallel().
+// Only one record at a time uses the workers, others work alone.
+
+class StreamWorkers
+{
+    epicsMutex inUse;
+    epicsMutex lock;
+    epicsEvent work;
+    epicsEvent done;
+    void (*job)(void*);
+    void** args;
+    size_t count;
+    size_t next;
+    size_t finished;
+    int threads;
+
+    bool runNext();
+    static void worker(void* workers);
+
+public:
+    StreamWorkers() : job(NULL), args(NULL), count(0), next(0),
+        finished(0), threads(0) {}
+    bool run(void (*job)(void*), void* args[], size_t count,
+        int numThreads);
+};
+
+static StreamWorkers streamWorkers;
+
+#if defined(__GNUC__)
+// Messages queued by StreamError/StreamDebugClass with streamAsyncLog set
+// and written by one logging thread, so that no port thread waits for
+// output. Bounded lock-free multi-producer queue; if it is full, the
+// message is dropped and counted. The logging thread sleeps while the
+// queue is empty and is woken up by the next message.
+
+class StreamLogger
+{
+    struct Cell
+    {
+        volatile size_t sequence;
+        StreamLogTarget target;
+        char* message;
+        size_t length;
+    };
+    enum { QueueSize = 1024 };
+    Cell cells[QueueSize];
+    volatile size_t head;         // next cell to fill
+    size_t tail;                  // next cell to write (logging thread)
+    volatile unsigned long dropped;
+    volatile bool running;
+    volatile bool waiting;        // logging thread waits for wakeup
+    epicsMutex startLock;
+    epicsMutex fileLock;          // StreamDebugFile used by logging thread
+    epicsEvent wakeup;            // queue is not empty any more
+    epicsEvent idle;              // queue is empty (for drain)
+
+    bool start();
+    bool writeNext();
+    bool empty() const { return cells[tail % QueueSize].sequence != tail + 1; }
+    static void run(void* logger);
+
+public:
+    StreamLogger();
+    bool queue(StreamLogTarget target, const char* message, size_t length);
+    void drain();
+    void setFile(FILE* file);
+    static bool queueMessage(StreamLogTarget target,
+        const char* message, size_t length);
+};
+
+static StreamLogger streamLogger;
+#endif
+
+// Prints the streamErrorWindow summaries when no further error of the
+// class comes. One timer for all streams, created on first use.
+
+class StreamErrorTimer : public epicsTimerNotify
+{
+    epicsMutex lock;
+    epicsTimerQueueActive* timerQueue;
+    epicsTimer* timer;
+    Stream* stream;               // any stream, for the error group lock
+
+    expireStatus expire(const epicsTime&);
+public:
+    StreamErrorTimer() : timerQueue(NULL), timer(NULL), stream(NULL) {}
+    void start(Stream* stream, double delay);
+};
+
+static StreamErrorTimer streamErrorTimer;
+
+// One timer wheel per port with one thread calling expire() of the
+// timers, instead of one epicsTimer per record and bus interface.
+// Threads are never stopped.
+
+class StreamPortTimer::Thread : public StreamTimerWheel
+{
+    static epicsMutex listLock;
+    static Thread* first;
+
+    Thread* next;
+    StreamBuffer portname;
+    epicsMutex lock;
+    epicsEvent wakeup;
+    epicsEvent cancelBlockingEvent;
+    epicsThreadId threadId;
+    StreamPortTimer* running;     // expire() is running (without lock)
+    bool cancelPending;           // cancel() waits for running expire()
+    bool sleeping;
+    bool idle;                    // sleeping without timers pending
+    unsigned long wakeTime;
+    unsigned long lastClock;
+    unsigned long ticks;
+
+    Thread(const char* portname);
+    unsigned long clock();
+    static void run(void* thread);
+
+public:
+    static Thread* attach(const char* portname);
+    void start(StreamPortTimer& timer, double delay);
+    void cancel(StreamPortTimer& timer);
+};
+
+// waveform and aai input is parsed into a second buffer
+// which is swapped with the record buffer on success
+int streamDoubleBuffer = 0;
+
 
 // shell functions ///////////////////////////////////////////////////////
 extern "C" { // needed for Windows
@@ -160,7 +353,17 @@ epicsExportAddress(int, streamDebug);
 epicsExportAddress(int, streamError);
 epicsExportAddress(int, streamDebugColored);
 epicsExportAddress(int, streamErrorDeadTime);
+epicsExportAddress(int, streamErrorWindow);
 epicsExportAddress(int, streamMsgTimeStamped);
+epicsExportAddress(int, streamAsyncLog);
+epicsExportAddress(int, streamConverterStats);
+epicsExportAddress(int, streamArrayPrescan);
+epicsExportAddress(int, streamParseThreads);
+epicsExportAddress(int, streamParseThreshold);
+epicsExportAddress(int, streamDoubleBuffer);
+epicsExportAddress(int, streamTraceSize);
+epicsExportAddress(int, streamLatencyStats);
+epicsExportAddress(int, streamTimerWheel);
 }
 
 // for subroutine record
@@ -203,7 +406,7 @@ long streamReload(const char* recordname)
 
 long streamSetLogfile(const char* filename)
 {
-    FILE *oldfile, *newfile = NULL;
+    FILE *newfile = NULL;
     if (filename)
     {
         newfile = fopen(filename, "w");
@@ -213,9 +416,13 @@ long streamSetLogfile(const char* filename)
             return ERROR;
         }
     }
-    oldfile = StreamDebugFile;
+#if defined(__GNUC__)
+    streamLogger.setFile(newfile);
+#else
+    FILE *oldfile = StreamDebugFile;
     StreamDebugFile = newfile;
     if (oldfile) fclose(oldfile);
+#endif
     return OK;
 }
 
@@ -255,11 +462,52 @@ void streamSetLogfileFunc (const iocshArgBuf *args)
     streamSetLogfile(args[0].sval);
 }
 
+static const iocshArg streamReportConvertersArg0 =
+    { "reset", iocshArgInt };
+static const iocshArg * const streamReportConvertersArgs[] =
+    { &streamReportConvertersArg0 };
+static const iocshFuncDef streamReportConvertersDef =
+    { "streamReportConverters", 1, streamReportConvertersArgs };
+
+void streamReportConvertersFunc (const iocshArgBuf *args)
+{
+    streamReportConverters(args[0].ival);
+}
+
+static const iocshArg streamReportTraceArg0 =
+    { "recordname", iocshArgString };
+static const iocshArg * const streamReportTraceArgs[] =
+    { &streamReportTraceArg0 };
+static const iocshFuncDef streamReportTraceDef =
+    { "streamReportTrace", 1, streamReportTraceArgs };
+
+void streamReportTraceFunc (const iocshArgBuf *args)
+{
+    streamReportTrace(args[0].sval);
+}
+
+static const iocshArg streamReportLatencyArg0 =
+    { "recordname", iocshArgString };
+static const iocshArg streamReportLatencyArg1 =
+    { "reset", iocshArgInt };
+static const iocshArg * const streamReportLatencyArgs[] =
+    { &streamReportLatencyArg0, &streamReportLatencyArg1 };
+static const iocshFuncDef streamReportLatencyDef =
+    { "streamReportLatency", 2, streamReportLatencyArgs };
+
+void streamReportLatencyFunc (const iocshArgBuf *args)
+{
+    streamReportLatency(args[0].sval, args[1].ival);
+}
+
 static void streamRegistrar ()
 {
     iocshRegister(&streamReloadDef, streamReloadFunc);
     iocshRegister(&streamReportRecordDef, streamReportRecordFunc);
     iocshRegister(&streamSetLogfileDef, streamSetLogfileFunc);
+    iocshRegister(&streamReportConvertersDef, streamReportConvertersFunc);
+    iocshRegister(&streamReportTraceDef, streamReportTraceFunc);
+    iocshRegister(&streamReportLatencyDef, streamReportLatencyFunc);
     // make streamReload available for subroutine records
     registryFunctionAdd("streamReload",
         (REGISTRYFUNCTION)streamReloadSub);
@@ -363,6 +611,12 @@ long streamReportRecord(const char* recordname)
             StreamBuffer buffer;
             stream->printStatus(buffer);
             printf("%s\n", buffer());
+            if (streamLatencyStats)
+            {
+                buffer.clear();
+                stream->printLatency(buffer);
+                printf("%s", buffer());
+            }
             stream->printProtocol(stdout);
             printf("\n");
         }
@@ -370,6 +624,92 @@ long streamReportRecord(const char* recordname)
     return OK;
 }
 
+long streamReportTrace(const char* recordname)
+{
+    Stream* stream;
+    if (streamTraceSize <= 0)
+        printf("Trace is off. "
+            "Set streamTraceSize to the number of events to keep.\n");
+    for (stream = static_cast<Stream*>(Stream::first); stream;
+        stream = static_cast<Stream*>(stream->next))
+    {
+        if (!recordname ||
+            epicsStrGlobMatch(stream->name(), recordname))
+        {
+            StreamBuffer buffer;
+            stream->printTrace(buffer);
+            printf("%s:\n%s", stream->name(), buffer());
+        }
+    }
+    return OK;
+}
+
+long streamReportLatency(const char* recordname, int reset)
+{
+    // Print histograms summed up per bus and then per record.
+    Stream* stream;
+    Stream* other;
+    if (!streamLatencyStats)
+        printf("Latency statistics are off. "
+            "Set streamLatencyStats=1 to enable.\n");
+    for (stream = static_cast<Stream*>(Stream::first); stream;
+        stream = static_cast<Stream*>(stream->next))
+    {
+        if (recordname &&
+            !epicsStrGlobMatch(stream->name(), recordname)) continue;
+        // first matching record of this bus?
+        for (other = static_cast<Stream*>(Stream::first); other != stream;
+            other = static_cast<Stream*>(other->next))
+        {
+            if ((!recordname ||
+                epicsStrGlobMatch(other->name(), recordname)) &&
+                strcmp(other->bus(), stream->bus()) == 0) break;
+        }
+        if (other != stream) continue;
+        Stream::LatencyHistograms sum;
+        memset(sum, 0, sizeof(sum));
+        for (; other; other = static_cast<Stream*>(other->next))
+        {
+            if ((!recordname ||
+                epicsStrGlobMatch(other->name(), recordname)) &&
+                strcmp(other->bus(), stream->bus()) == 0)
+            {
+                other->lockMutex();
+                other->addLatency(sum);
+                other->releaseMutex();
+            }
+        }
+        StreamBuffer buffer;
+        Stream::printLatency(buffer, sum);
+        printf("bus %s:\n%s", stream->bus(), buffer());
+    }
+    for (stream = static_cast<Stream*>(Stream::first); stream;
+        stream = static_cast<Stream*>(stream->next))
+    {
+        if (recordname &&
+            !epicsStrGlobMatch(stream->name(), recordname)) continue;
+        StreamBuffer buffer;
+        stream->lockMutex();
+        stream->printLatency(buffer);
+        if (reset) stream->resetLatency();
+        stream->releaseMutex();
+        printf("%s:\n%s", stream->name(), buffer());
+    }
+    return OK;
+}
+
+long streamReportConverters(int reset)
+{
+    StreamBuffer buffer;
+    if (!streamConverterStats)
+        printf("Converter statistics are off. "
+            "Set streamConverterStats=1 to enable.\n");
+    StreamFormatConverter::printStatistics(buffer);
+    printf("%s", buffer());
+    if (reset) StreamFormatConverter::resetStatistics();
+    return OK;
+}
+
 #if defined(_WIN32) && !defined(_WIN64)
 static const char* epicsThreadGetNameSelfWrapper(void)
 {
@@ -382,6 +722,9 @@ static int terminating = 0;
 static void streamExitHook(void*)
 {
     terminating = 1;
+#if defined(__GNUC__)
+    streamLogger.drain();
+#endif
 }
 
 long Stream::
@@ -414,6 +757,9 @@ drvInit()
         StreamProtocolParser::path);
     StreamPrintTimestampFunction = streamEpicsPrintTimestamp;
     StreamGetThreadNameFunction = epicsThreadGetNameSelf;
+#if defined(__GNUC__)
+    StreamQueueMessageFunction = StreamLogger::queueMessage;
+#endif
     initHookRegister(initHook);
     epicsAtExit(streamExitHook, NULL);
 
@@ -449,6 +795,10 @@ initHook(initHookState state)
                         stream->name());
                 }
                 stream->initDone.wait();
+                dbScanLock(stream->record);
+                if (stream->status == NO_ALARM) stream->swapBuffer();
+                stream->swapBptr = NULL;
+                dbScanUnlock(stream->record);
             }
             break;
         }
@@ -540,6 +890,10 @@ long streamInitRecord(dbCommon* record, const struct link *ioLink,
         debug("streamInitRecord(%s): stop running protocol\n",
             record->name);
         stream->finishProtocol(Stream::Abort);
+        // streamDoubleBuffer may have been switched off
+        stream->lockMutex();
+        stream->freeShadowBuffer();
+        stream->releaseMutex();
     }
     if (ioLink->type != INST_IO)
     {
@@ -652,6 +1006,68 @@ ssize_t streamScanfN(dbCommon* record, format_t *format,
     return size;
 }
 
+long streamPrintfArray(dbCommon *record, format_t *format,
+    const void* values, unsigned short ftvl, size_t count)
+{
+    debug("streamPrintfArray(%s,format=%%%c,%" Z "u elements)\n",
+        record->name, format->priv->conv, count);
+    Stream* stream = static_cast<Stream*>(record->dpvt);
+    if (!stream) return ERROR;
+    return stream->printArray(format, values, ftvl, count) ? OK : ERROR;
+}
+
+ssize_t streamScanfArray(dbCommon *record, format_t *format,
+    void* values, unsigned short ftvl, size_t maxElements)
+{
+    Stream* stream = static_cast<Stream*>(record->dpvt);
+    if (!stream) return ERROR;
+    return stream->scanArray(format, values, ftvl, maxElements);
+}
+
+void* streamShadowBuffer(dbCommon *record, size_t size)
+{
+    // second buffer for array input in double buffer mode
+    Stream* stream = static_cast<Stream*>(record->dpvt);
+    if (!stream || !streamDoubleBuffer) return NULL;
+#ifndef WITH_SHADOW_BUFFER
+    static int warned = 0;
+    if (!warned)
+    {
+        error("streamDoubleBuffer is not supported with this EPICS version\n");
+        warned = 1;
+    }
+    return NULL;
+#else
+    // a swap not yet done would now expose a half parsed buffer
+    stream->swapBptr = NULL;
+    if (!stream->shadowBuffer)
+    {
+        stream->shadowBuffer = calloc(1, size);
+        if (!stream->shadowBuffer)
+        {
+            error("%s: can't allocate %" Z "u bytes for double buffer\n",
+                record->name, size);
+            return NULL;
+        }
+        debug("streamShadowBuffer(%s): %" Z "u bytes allocated\n",
+            record->name, size);
+    }
+    return stream->shadowBuffer;
+#endif
+}
+
+void streamSwapBuffer(dbCommon *record, void** bptr,
+    epicsUInt32* nord, epicsUInt32 count)
+{
+    // exchange the record buffer with the shadow buffer later
+    // when the record is processed (with dbScanLock held)
+    Stream* stream = static_cast<Stream*>(record->dpvt);
+    if (!stream || !stream->shadowBuffer) return;
+    stream->swapBptr = bptr;
+    stream->swapNord = nord;
+    stream->swapCount = count;
+}
+
 // Stream methods ////////////////////////////////////////////////////////
 
 Stream::
@@ -667,8 +1083,9 @@ Stream(dbCommon* _record, const struct link *ioLink,
     callbackSetCallback(expire, &timeoutCallback);
     callbackSetUser(this, &timeoutCallback);
 #else
-    timerQueue = &epicsTimerQueueActive::allocate(true);
-    timer = &timerQueue->createTimer();
+    // created in initRecord unless the port timer is used
+    timerQueue = NULL;
+    timer = NULL;
 #endif
     callbackSetCallback(executeCommand, &commandCallback);
     callbackSetUser(this, &commandCallback);
@@ -676,6 +1093,11 @@ Stream(dbCommon* _record, const struct link *ioLink,
     callbackSetUser(this, &processCallback);
     status = ERROR;
     convert = DO_NOT_CONVERT;
+    arrayValues = NULL;
+    arraySize = 0;
+    shadowBuffer = NULL;
+    swapBptr = NULL;
+    portTimer = NULL;
     ioscanpvt = NULL;
 }
 
@@ -692,13 +1114,39 @@ Stream::
         record->dpvt = NULL;
         debug("~Stream(%s): dpvt cleared\n", name());
     }
-    timer->destroy();
+    delete portTimer;
+    if (timer) timer->destroy();
     debug("~Stream(%s): timer destroyed\n", name());
-    timerQueue->release();
+    if (timerQueue) timerQueue->release();
     debug("~Stream(%s): timer queue released\n", name());
+    delete [] arrayValues;
+    freeShadowBuffer();
     releaseMutex();
 }
 
+void Stream::
+swapBuffer()
+{
+    // Make the new array visible. Call with dbScanLock held
+    // (or in iocInit) because clients may access the record buffer.
+    if (!swapBptr) return;
+    debug("Stream::swapBuffer(%s): nord=%u\n", name(), swapCount);
+    void* buffer = *swapBptr;
+    *swapBptr = shadowBuffer;
+    shadowBuffer = buffer;
+    *swapNord = swapCount;
+    swapBptr = NULL;
+}
+
+void Stream::
+freeShadowBuffer()
+{
+    // after swapping, the record does not use the shadow buffer any more
+    swapBptr = NULL;
+    free(shadowBuffer);
+    shadowBuffer = NULL;
+}
+
 long Stream::
 initRecord(char* linkstring /* modifiable copy */)
 {
@@ -768,6 +1216,22 @@ initRecord(char* linkstring /* modifiable copy */)
             name(), busname, addr);
         return S_dev_noDevice;
     }
+    if (streamTimerWheel && !portTimer)
+    {
+        portTimer = new StreamPortTimer(busname, *this);
+        if (!portTimer->valid())
+        {
+            delete portTimer;
+            portTimer = NULL;
+        }
+    }
+#ifndef EPICS_3_13
+    if (!portTimer && !timer)
+    {
+        timerQueue = &epicsTimerQueueActive::allocate(true);
+        timer = &timerQueue->createTimer();
+    }
+#endif
 
     // parse protocol file
     debug("Stream::initRecord %s: parse(\"%s\", \"%s\")\n",
@@ -818,6 +1282,14 @@ initRecord(char* linkstring /* modifiable copy */)
         name());
     initDone.wait();
     debug("Stream::initRecord %s: initDone\n", name());
+    if (status == NO_ALARM)
+    {
+        // during iocInit no client can access the record yet
+        if (!INIT_RUN) dbScanLock(record);
+        swapBuffer();
+        if (!INIT_RUN) dbScanUnlock(record);
+    }
+    swapBptr = NULL;
 
     // init run has set status and convert
     if (status != NO_ALARM)
@@ -843,6 +1315,7 @@ process()
         record->proc = 0;
         if (status != NO_ALARM)
         {
+            swapBptr = NULL;
             debug("Stream::process(%s) error status=%s (%d)\n",
                 name(),
                 status >= 0 && status < ALARM_NSTATUS ?
@@ -851,6 +1324,7 @@ process()
             (void) recGblSetSevr(record, status, INVALID_ALARM);
             return false;
         }
+        swapBuffer();
         debug("Stream::process(%s) ready. %s\n",
             name(), convert == DO_NOT_CONVERT ?
             "convert" : "don't convert");
@@ -866,6 +1340,7 @@ process()
     debug("Stream::process(%s) start\n", name());
     status = NO_ALARM;
     convert = OK;
+    swapBptr = NULL;
     if (record->tpro)
     {
         StreamDebugClass(record->name).print("start protocol '%s'\n", protocolname());
@@ -945,6 +1420,287 @@ scan(format_t *format, void* value, size_t maxStringSize)
     return OK;
 }
 
+long* Stream::
+reserveArray(size_t count)
+{
+    if (count > arraySize)
+    {
+        delete [] arrayValues;
+        arrayValues = new long [count];
+        arraySize = count;
+    }
+    return arrayValues;
+}
+
+bool Stream::
+printArray(format_t *format, const void* values,
+    unsigned short ftvl, size_t count)
+{
+    // called by streamPrintfArray
+    // Convert the whole array to long and let the converter print it.
+
+    if (format->type == DBF_DOUBLE)
+        return printDoubleArray(*format->priv, values, ftvl, count);
+    if (format->type != DBF_ULONG && format->type != DBF_LONG &&
+        format->type != DBF_ENUM)
+    {
+        error("INTERNAL ERROR (%s): Illegal format type %d for array\n",
+            name(), format->type);
+        return false;
+    }
+    long* lvals = reserveArray(count);
+    size_t i;
+    switch (ftvl)
+    {
+#ifdef DBR_INT64
+        case DBF_INT64:
+            for (i = 0; i < count; i++)
+                lvals[i] = (long)((epicsInt64 *)values)[i];
+            break;
+        case DBF_UINT64:
+            for (i = 0; i < count; i++)
+                lvals[i] = (long)((epicsUInt64 *)values)[i];
+            break;
+#endif
+        case DBF_LONG:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsInt32 *)values)[i];
+            break;
+        case DBF_ULONG:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsUInt32 *)values)[i];
+            break;
+        case DBF_SHORT:
+        case DBF_ENUM:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsInt16 *)values)[i];
+            break;
+        case DBF_USHORT:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsUInt16 *)values)[i];
+            break;
+        case DBF_CHAR:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsInt8 *)values)[i];
+            break;
+        case DBF_UCHAR:
+            for (i = 0; i < count; i++)
+                lvals[i] = ((epicsUInt8 *)values)[i];
+            break;
+        default:
+            error("%s: can't convert from %s to long\n",
+                name(), pamapdbfType[ftvl].strvalue);
+            return false;
+    }
+    return printValues(*format->priv, lvals, count);
+}
+
+ssize_t Stream::
+scanArray(format_t *format, void* values,
+    unsigned short ftvl, size_t maxElements)
+{
+    // called by streamScanfArray
+    // Let the converter scan the whole array as long and convert it.
+
+    size_t i, count = maxElements;
+    consumedInput += currentValueLength;
+    currentValueLength = 0;
+    if (format->type == DBF_DOUBLE)
+        return scanDoubleArray(*format->priv, values, ftvl, maxElements);
+    if (format->type != DBF_ULONG && format->type != DBF_LONG &&
+        format->type != DBF_ENUM)
+    {
+        error("INTERNAL ERROR (%s): Illegal format type %d for array\n",
+            name(), format->type);
+        return ERROR;
+    }
+    switch (ftvl)
+    {
+        case DBF_DOUBLE:
+        case DBF_FLOAT:
+#ifdef DBR_INT64
+        case DBF_INT64:
+        case DBF_UINT64:
+#endif
+        case DBF_LONG:
+        case DBF_ULONG:
+        case DBF_SHORT:
+        case DBF_USHORT:
+        case DBF_ENUM:
+        case DBF_CHAR:
+        case DBF_UCHAR:
+            break;
+        default:
+            error("%s: can't convert from long to %s\n",
+                name(), pamapdbfType[ftvl].strvalue);
+            return ERROR;
+    }
+    long* lvals = reserveArray(count);
+    ssize_t consumed = scanValues(*format->priv, lvals, count);
+    debug("Stream::scanArray() %" Z "u elements, %" Z "d bytes\n", count, consumed);
+    if (consumed < 0) return ERROR;
+    switch (ftvl)
+    {
+        case DBF_DOUBLE:
+            for (i = 0; i < count; i++)
+                ((epicsFloat64 *)values)[i] = (epicsFloat64)lvals[i];
+            break;
+        case DBF_FLOAT:
+            for (i = 0; i < count; i++)
+                ((epicsFloat32 *)values)[i] = (epicsFloat32)lvals[i];
+            break;
+#ifdef DBR_INT64
+        case DBF_INT64:
+        case DBF_UINT64:
+            for (i = 0; i < count; i++)
+                ((epicsInt64 *)values)[i] = (epicsInt64)lvals[i];
+            break;
+#endif
+        case DBF_LONG:
+        case DBF_ULONG:
+            for (i = 0; i < count; i++)
+                ((epicsInt32 *)values)[i] = (epicsInt32)lvals[i];
+            break;
+        case DBF_SHORT:
+        case DBF_USHORT:
+        case DBF_ENUM:
+            for (i = 0; i < count; i++)
+                ((epicsInt16 *)values)[i] = (epicsInt16)lvals[i];
+            break;
+        case DBF_CHAR:
+        case DBF_UCHAR:
+            for (i = 0; i < count; i++)
+                ((epicsInt8 *)values)[i] = (epicsInt8)lvals[i];
+            break;
+    }
+    // Don't remove scanned values from inputLine yet, because
+    // we might need the string in a later error message.
+    currentValueLength = consumed;
+    return count;
+}
+
+bool Stream::
+printDoubleArray(const StreamFormat& format, const void* values,
+    unsigned short ftvl, size_t count)
+{
+    // called by printArray
+    // One loop per field type, thus no type switch and no varargs
+    // call of streamPrintf() per element.
+
+    size_t i;
+    switch (ftvl)
+    {
+        case DBF_DOUBLE:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsFloat64 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_FLOAT:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsFloat32 *)values)[i]))
+                    return false;
+            return true;
+#ifdef DBR_INT64
+        case DBF_INT64:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsInt64 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_UINT64:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsUInt64 *)values)[i]))
+                    return false;
+            return true;
+#endif
+        case DBF_LONG:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsInt32 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_ULONG:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsUInt32 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_SHORT:
+        case DBF_ENUM:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsInt16 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_USHORT:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsUInt16 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_CHAR:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsInt8 *)values)[i]))
+                    return false;
+            return true;
+        case DBF_UCHAR:
+            for (i = 0; i < count; i++)
+                if (!printValue(format, (double)((epicsUInt8 *)values)[i]))
+                    return false;
+            return true;
+        default:
+            error("%s: can't convert from %s to double\n",
+                name(), pamapdbfType[ftvl].strvalue);
+            return false;
+    }
+}
+
+bool Stream::
+scanNextValue(const StreamFormat& format, double& value)
+{
+    // like streamScanf() called for each array element
+    consumedInput += currentValueLength;
+    currentValueLength = scanValue(format, value);
+    if (currentValueLength < 0)
+    {
+        currentValueLength = 0; // important for arrays with less than NELM elements
+        return false;
+    }
+    return true;
+}
+
+ssize_t Stream::
+scanDoubleArray(const StreamFormat& format, void* values,
+    unsigned short ftvl, size_t maxElements)
+{
+    // called by scanArray
+    // One loop per field type, thus no type switch and no
+    // streamScanf() call per element.
+
+    size_t count;
+    double dval;
+    switch (ftvl)
+    {
+        case DBF_DOUBLE:
+            for (count = 0; count < maxElements; count++)
+            {
+                if (!scanNextValue(format, dval)) break;
+                ((epicsFloat64 *)values)[count] = (epicsFloat64)dval;
+            }
+            break;
+        case DBF_FLOAT:
+            for (count = 0; count < maxElements; count++)
+            {
+                if (!scanNextValue(format, dval)) break;
+                ((epicsFloat32 *)values)[count] = (epicsFloat32)dval;
+            }
+            break;
+        default:
+            error("%s: can't convert from double to %s\n",
+                name(), pamapdbfType[ftvl].strvalue);
+            return ERROR;
+    }
+    debug("Stream::scanDoubleArray() %" Z "u elements\n", count);
+    // Don't remove the last scanned value from inputLine yet, because
+    // we might need the string in a later error message.
+    return count;
+}
+
 // epicsTimerNotify virtual method ///////////////////////////////////////
 
 epicsTimerNotify::expireStatus Stream::
@@ -1050,6 +1806,9 @@ recordProcessCallback()
     // This will call streamReadWrite.
     debug("recordProcessCallback(%s) processing record\n", name());
     dbScanLock(record);
+    lockMutex();
+    latencyCount(LatencyProcess, finishTime);
+    releaseMutex();
     ((DEVSUPFUN)record->rset->process)(record);
     dbScanUnlock(record);
     debug("recordProcessCallback(%s) processing record done\n", name());
@@ -1068,7 +1827,409 @@ startTimer(unsigned long timeout)
 {
     debug("Stream::startTimer(stream=%s, timeout=%lu) = %f seconds\n",
         name(), timeout, timeout * 0.001);
-    timer->start(*this, timeout * 0.001);
+    if (portTimer)
+        portTimer->start(timeout * 0.001);
+    else if (timer)
+        timer->start(*this, timeout * 0.001);
+}
+
+unsigned long Stream::
+getTime()
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    // wraps around, but only differences are used
+    return now.secPastEpoch * 1000UL + now.nsec / 1000000;
+}
+
+double Stream::
+getPreciseTime()
+{
+#ifdef WITH_MONOTONIC_TIME
+    // not affected by NTP adjustments
+    return epicsMonotonicGet() * 1e-9;
+#else
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return now.secPastEpoch + now.nsec * 1e-9;
+#endif
+}
+
+void Stream::
+parallel(void (*job)(void*), void* args[], size_t count)
+{
+    if (!streamWorkers.run(job, args, count, streamParseThreads))
+        StreamCore::parallel(job, args, count);
+}
+
+bool StreamWorkers::
+run(void (*_job)(void*), void* _args[], size_t _count, int numThreads)
+{
+    if (!inUse.tryLock()) return false; // busy with other record
+    // the calling thread works too
+    while (threads < numThreads - 1)
+    {
+        if (!epicsThreadCreate("streamWorker", epicsThreadPriorityMedium,
+            epicsThreadGetStackSize(epicsThreadStackMedium),
+            worker, this))
+        {
+            error("StreamWorkers: cannot create worker thread\n");
+            break;
+        }
+        threads++;
+    }
+    lock.lock();
+    job = _job;
+    args = _args;
+    count = _count;
+    next = 0;
+    finished = 0;
+    lock.unlock();
+    work.signal();
+    while (runNext());
+    lock.lock();
+    while (finished < count)
+    {
+        lock.unlock();
+        done.wait();
+        lock.lock();
+    }
+    job = NULL;
+    lock.unlock();
+    inUse.unlock();
+    return true;
+}
+
+bool StreamWorkers::
+runNext()
+{
+    lock.lock();
+    if (!job || next >= count)
+    {
+        lock.unlock();
+        return false;
+    }
+    void* arg = args[next++];
+    void (*thisJob)(void*) = job;
+    lock.unlock();
+    // wake up the next worker for the next job
+    work.signal();
+    thisJob(arg);
+    lock.lock();
+    if (++finished == count) done.signal();
+    lock.unlock();
+    return true;
+}
+
+void StreamWorkers::
+worker(void* arg)
+{
+    StreamWorkers* workers = static_cast<StreamWorkers*>(arg);
+    while (1)
+    {
+        workers->work.wait();
+        while (workers->runNext());
+    }
+}
+
+#if defined(__GNUC__)
+StreamLogger::
+StreamLogger() : head(0), tail(0), dropped(0), running(false),
+    waiting(false)
+{
+    size_t i;
+    for (i = 0; i < QueueSize; i++)
+        cells[i].sequence = i;
+}
+
+bool StreamLogger::
+start()
+{
+    startLock.lock();
+    if (!running)
+    {
+        running = epicsThreadCreate("streamLogger",
+            epicsThreadPriorityLow,
+            epicsThreadGetStackSize(epicsThreadStackSmall),
+            run, this) != NULL;
+    }
+    startLock.unlock();
+    return running;
+}
+
+bool StreamLogger::
+queue(StreamLogTarget target, const char* message, size_t length)
+{
+    if (!running && !start()) return false;
+    size_t pos = head;
+    Cell* cell;
+    while (1)
+    {
+        cell = &cells[pos % QueueSize];
+        ssize_t diff = (ssize_t)(cell->sequence - pos);
+        if (diff == 0)
+        {
+            // cell is free: try to claim it
+            if (__sync_bool_compare_and_swap(&head, pos, pos + 1)) break;
+            pos = head;
+        }
+        else if (diff < 0)
+        {
+            // queue is full
+            __sync_fetch_and_add(&dropped, 1);
+            return true;
+        }
+        else pos = head;
+    }
+    cell->message = (char*)malloc(length);
+    if (!cell->message)
+    {
+        __sync_fetch_and_add(&dropped, 1);
+        length = 0;
+    }
+    else memcpy(cell->message, message, length);
+    cell->target = target;
+    cell->length = length;
+    __sync_synchronize();
+    cell->sequence = pos + 1;
+    __sync_synchronize();
+    if (waiting) wakeup.signal();
+    return true;
+}
+
+bool StreamLogger::
+writeNext()
+{
+    Cell* cell = &cells[tail % QueueSize];
+    if (cell->sequence != tail + 1) return false;
+    __sync_synchronize();
+    fileLock.lock();
+    FILE* fp = cell->target == StreamLogStderr ? stderr : StreamDebugFile;
+    if (!fp && cell->target == StreamLogDebug) fp = stderr;
+    if (fp && cell->length) fwrite(cell->message, 1, cell->length, fp);
+    fileLock.unlock();
+    free(cell->message);
+    __sync_synchronize();
+    cell->sequence = tail + QueueSize;
+    tail++;
+    return true;
+}
+
+void StreamLogger::
+run(void* arg)
+{
+    StreamLogger* logger = static_cast<StreamLogger*>(arg);
+    unsigned long reported = 0;
+    while (1)
+    {
+        if (logger->writeNext()) continue;
+        // queue is empty
+        fflush(stderr);
+        logger->fileLock.lock();
+        if (StreamDebugFile) fflush(StreamDebugFile);
+        logger->fileLock.unlock();
+        if (logger->dropped != reported)
+        {
+            unsigned long dropped = logger->dropped;
+            fprintf(stderr, "streamLogger: %lu messages dropped\n",
+                dropped - reported);
+            reported = dropped;
+        }
+        logger->idle.signal();
+        logger->waiting = true;
+        __sync_synchronize();
+        // a message queued before waiting was set did not signal
+        if (logger->empty()) logger->wakeup.wait(1.0);
+        logger->waiting = false;
+    }
+}
+
+void StreamLogger::
+drain()
+{
+    // give the logging thread up to 1 second to write queued messages
+    int i;
+    for (i = 0; running && i < 10 && !empty(); i++)
+        idle.wait(0.1);
+}
+
+void StreamLogger::
+setFile(FILE* file)
+{
+    // close the old file only when the logging thread does not use it
+    fileLock.lock();
+    FILE* oldfile = StreamDebugFile;
+    StreamDebugFile = file;
+    fileLock.unlock();
+    if (oldfile) fclose(oldfile);
+}
+
+bool StreamLogger::
+queueMessage(StreamLogTarget target, const char* message, size_t length)
+{
+    return streamLogger.queue(target, message, length);
+}
+#endif
+
+epicsMutex StreamPortTimer::Thread::listLock;
+StreamPortTimer::Thread* StreamPortTimer::Thread::first = NULL;
+
+StreamPortTimer::Thread::
+Thread(const char* portname) : StreamTimerWheel(0),
+    next(NULL), portname(portname), threadId(NULL), running(NULL),
+    cancelPending(false), sleeping(false), idle(false), wakeTime(0),
+    ticks(0)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    lastClock = now.secPastEpoch * 1000UL + now.nsec / 1000000;
+}
+
+StreamPortTimer::Thread* StreamPortTimer::Thread::
+attach(const char* portname)
+{
+    Thread* thread;
+
+    listLock.lock();
+    for (thread = first; thread; thread = thread->next)
+    {
+        if (strcmp(thread->portname(), portname) == 0) break;
+    }
+    if (!thread)
+    {
+        thread = new Thread(portname);
+        // protocol timeouts must not starve behind scan threads
+        thread->threadId = epicsThreadCreate("streamTimer",
+            epicsThreadPriorityScanHigh,
+            epicsThreadGetStackSize(epicsThreadStackMedium),
+            run, thread);
+        if (!thread->threadId)
+        {
+            error("StreamPortTimer: cannot create timer thread for %s\n",
+                portname);
+            delete thread;
+            thread = NULL;
+        }
+        else
+        {
+            thread->next = first;
+            first = thread;
+        }
+    }
+    listLock.unlock();
+    return thread;
+}
+
+unsigned long StreamPortTimer::Thread::
+clock()
+{
+    // milliseconds, not going back when the system clock is set back
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    unsigned long ms = now.secPastEpoch * 1000UL + now.nsec / 1000000;
+    if ((long)(ms - lastClock) > 0) ticks += ms - lastClock;
+    lastClock = ms;
+    return ticks;
+}
+
+void StreamPortTimer::Thread::
+run(void* arg)
+{
+    Thread* thread = static_cast<Thread*>(arg);
+    StreamTimerWheel::Timer* timer;
+    unsigned long now, timeout;
+
+    thread->lock.lock();
+    while (1)
+    {
+        now = thread->clock();
+        while ((timer = thread->expired(now)) != NULL)
+        {
+            thread->running = static_cast<StreamPortTimer*>(timer);
+            thread->lock.unlock();
+            timer->expire();
+            thread->lock.lock();
+            thread->running = NULL;
+            if (thread->cancelPending)
+            {
+                thread->cancelPending = false;
+                thread->cancelBlockingEvent.signal();
+            }
+            now = thread->clock();
+        }
+        timeout = thread->nextTimeout(now, 0);
+        thread->wakeTime = now + timeout;
+        thread->idle = !thread->pending();
+        thread->sleeping = true;
+        thread->lock.unlock();
+        if (thread->idle)
+            thread->wakeup.wait();
+        else
+            thread->wakeup.wait(timeout * 0.001);
+        thread->lock.lock();
+        thread->sleeping = false;
+    }
+}
+
+void StreamPortTimer::Thread::
+start(StreamPortTimer& timer, double delay)
+{
+    lock.lock();
+    // at least delay, as the current millisecond has already begun
+    unsigned long expires = clock() + (unsigned long)(delay * 1000) + 1;
+    StreamTimerWheel::start(timer, expires);
+    if (sleeping && (idle || (long)(expires - wakeTime) < 0))
+    {
+        sleeping = false;
+        wakeup.signal();
+    }
+    lock.unlock();
+}
+
+void StreamPortTimer::Thread::
+cancel(StreamPortTimer& timer)
+{
+    lock.lock();
+    StreamTimerWheel::cancel(timer);
+    // like epicsTimer::cancel(): wait for a running expire() to finish
+    while (running == &timer && threadId != epicsThreadGetIdSelf())
+    {
+        cancelPending = true;
+        lock.unlock();
+        cancelBlockingEvent.wait(1.0);
+        lock.lock();
+    }
+    lock.unlock();
+}
+
+StreamPortTimer::
+StreamPortTimer(const char* portname, epicsTimerNotify& notify)
+    : thread(Thread::attach(portname)), notify(notify)
+{
+}
+
+StreamPortTimer::
+~StreamPortTimer()
+{
+    cancel();
+}
+
+void StreamPortTimer::
+start(double delay)
+{
+    if (thread) thread->start(*this, delay);
+}
+
+void StreamPortTimer::
+cancel()
+{
+    if (thread) thread->cancel(*this);
+}
+
+void StreamPortTimer::
+expire()
+{
+    notify.expire(epicsTime::getCurrent());
 }
 
 bool Stream::
@@ -1162,6 +2323,13 @@ formatValue(const StreamFormat& format, const void* fieldaddress)
             size = nelem;
         }
 
+        if (nelem > 1)
+        {
+            // large arrays are printed directly from the field
+            int direct = formatArrayField(format, pdbaddr);
+            if (direct >= 0) return direct;
+        }
+
         char* buffer = fieldBuffer.clear().reserve(size);
 
         if (dbGet(pdbaddr, fmt.type, buffer,
@@ -1242,6 +2410,116 @@ formatValue(const StreamFormat& format, const void* fieldaddress)
     return true;
 }
 
+int Stream::
+formatArrayField(const StreamFormat& format, DBADDR* pdbaddr)
+{
+    // Print numeric arrays directly from the field memory instead of
+    // copying them with dbGet() into a temporary buffer first.
+    // Only for field types where dbGet() would do a plain cast.
+    // Returns -1 if not possible, otherwise 1 for success or 0 for failure.
+    dbCommon* precord = pdbaddr->precord;
+    DBADDR addr = *pdbaddr;
+    long nelem = addr.no_elements;
+    long offset = 0;
+    bool success;
+
+    switch (addr.field_type)
+    {
+        case DBF_CHAR:
+        case DBF_UCHAR:
+        case DBF_SHORT:
+        case DBF_USHORT:
+        case DBF_LONG:
+        case DBF_ULONG:
+            if (format.type != signed_format &&
+                format.type != unsigned_format &&
+                format.type != double_format)
+                return -1;
+            break;
+        case DBF_FLOAT:
+        case DBF_DOUBLE:
+            if (format.type != double_format)
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+    if (precord != record) dbScanLock(precord);
+    if (precord->rset && precord->rset->get_array_info &&
+        ((long (*)(DBADDR*, long*, long*))precord->rset->get_array_info)
+            (&addr, &nelem, &offset) != 0)
+    {
+        // let dbGet() report the problem
+        if (precord != record) dbScanUnlock(precord);
+        return -1;
+    }
+    if (nelem > addr.no_elements) nelem = addr.no_elements;
+    debug("Stream::formatArrayField(%s): print %s.%s[%ld] from offset %ld\n",
+        name(), precord->name, ((dbFldDes*)addr.pfldDes)->name,
+        nelem, offset);
+    // circular buffers may wrap around at the end of the field
+    offset %= addr.no_elements;
+    if (offset + nelem <= addr.no_elements)
+        success = printFieldValues(format, &addr, offset, offset + nelem);
+    else
+        success = printFieldValues(format, &addr, offset, addr.no_elements) &&
+            printFieldValues(format, &addr, 0,
+                offset + nelem - addr.no_elements);
+    if (precord != record) dbScanUnlock(precord);
+    return success;
+}
+
+bool Stream::
+printFieldValues(const StreamFormat& format, const DBADDR* pdbaddr,
+    long first, long last)
+{
+    // Convert like dbGet() would: via the requested DBR type.
+    const void* values = pdbaddr->pfield;
+    bool u = format.type == unsigned_format;
+    bool d = format.type == double_format;
+    long i;
+
+#define PRINT_FIELD_VALUES(T) \
+    for (i = first; i < last; i++) \
+    { \
+        T v = ((const T*)values)[i]; \
+        if (!(d ? printValue(format, (double)v) : \
+            printValue(format, u ? (long)(epicsUInt32)v : (long)(epicsInt32)v))) \
+            return false; \
+    } \
+    break
+
+    switch (pdbaddr->field_type)
+    {
+        case DBF_CHAR:
+            PRINT_FIELD_VALUES(epicsInt8);
+        case DBF_UCHAR:
+            PRINT_FIELD_VALUES(epicsUInt8);
+        case DBF_SHORT:
+            PRINT_FIELD_VALUES(epicsInt16);
+        case DBF_USHORT:
+            PRINT_FIELD_VALUES(epicsUInt16);
+        case DBF_LONG:
+            PRINT_FIELD_VALUES(epicsInt32);
+        case DBF_ULONG:
+            PRINT_FIELD_VALUES(epicsUInt32);
+        case DBF_FLOAT:
+            for (i = first; i < last; i++)
+                if (!printValue(format,
+                    (double)((const epicsFloat32*)values)[i]))
+                    return false;
+            break;
+        case DBF_DOUBLE:
+            for (i = first; i < last; i++)
+                if (!printValue(format,
+                    (double)((const epicsFloat64*)values)[i]))
+                    return false;
+            break;
+    }
+#undef PRINT_FIELD_VALUES
+    return true;
+}
+
 bool Stream::
 matchValue(const StreamFormat& format, const void* fieldaddress)
 {
@@ -1274,7 +2552,13 @@ matchValue(const StreamFormat& format, const void* fieldaddress)
         }
         else
             size = nelem * dbValueSize(fmt.type);
-        buffer = fieldBuffer.clear().reserve(size);  // maybe write to field directly in case types match?
+        if (nelem > 1)
+        {
+            // large arrays of matching type go directly into the field
+            int direct = matchArrayField(format, pdbaddr, fmt.type);
+            if (direct >= 0) return direct;
+        }
+        buffer = fieldBuffer.clear().reserve(size);
         for (nord = 0; nord < nelem; nord++)
         {
             debug("Stream::matchValue(%s): buffer before: %s\n",
@@ -1416,6 +2700,25 @@ matchValue(const StreamFormat& format, const void* fieldaddress)
             nord = stringsize;
             fmt.type = DBF_CHAR;
         }
+        if (flags & BatchRedirects && pdbaddr->precord != record &&
+            !INIT_RUN && pdbaddr->field_type < DBF_INLINK)
+        {
+            // write into other record later in matchFinishHook()
+            // together with all other values of this input line
+            Redirect redirect;
+            redirect.addr = *pdbaddr;
+            redirect.nord = (long)nord;
+            redirect.size = nord * dbValueSize(fmt.type);
+            redirect.type = fmt.type;
+            redirects.append(&redirect, sizeof(redirect));
+            redirects.append(buffer, redirect.size);
+            debug("Stream::matchValue(%s): batch %s.%s, %s, %s\n",
+                name(), pdbaddr->precord->name,
+                ((dbFldDes*)pdbaddr->pfldDes)->name,
+                pamapdbfType[fmt.type].strvalue,
+                fieldBuffer.expand()());
+            return true;
+        }
         if (pdbaddr->precord == record || INIT_RUN)
         {
             // write into own record, thus don't process it
@@ -1505,6 +2808,178 @@ matchValue(const StreamFormat& format, const void* fieldaddress)
     return true;
 }
 
+int Stream::
+matchArrayField(const StreamFormat& format, DBADDR* pdbaddr, short type)
+{
+    // Parse array values directly into the field memory instead of
+    // into a temporary buffer that dbPut() would copy and convert.
+    // Only possible if no conversion is needed, the field has no
+    // special put handling and the record starts the array at offset 0.
+    // Returns -1 if not possible, otherwise 1 for success or 0 for failure.
+    dbCommon* precord = pdbaddr->precord;
+    dbFldDes* pfldDes = (dbFldDes*)pdbaddr->pfldDes;
+    DBADDR addr = *pdbaddr;
+    long nelem = addr.no_elements;
+    long offset = 0;
+    long nord = 0;
+    ssize_t consumed = 0;
+    long lval;
+    double dval;
+
+    if (addr.field_type != type ||
+        (type != DBF_LONG && type != DBF_ULONG && type != DBF_DOUBLE))
+        return -1;
+    if (addr.special != 0 && addr.special != SPC_DBADDR)
+        return -1;
+    if (precord != record && (INIT_RUN || flags & BatchRedirects))
+        return -1;
+    if (precord != record) dbScanLock(precord);
+    if (precord->rset && precord->rset->get_array_info)
+    {
+        // may modify addr.pfield
+        if (((long (*)(DBADDR*, long*, long*))precord->rset->get_array_info)
+            (&addr, &nord, &offset) != 0 || offset != 0)
+        {
+            if (precord != record) dbScanUnlock(precord);
+            return -1;
+        }
+    }
+    for (nord = 0; nord < nelem; nord++)
+    {
+        switch (type)
+        {
+            case DBF_ULONG:
+                consumed = scanValue(format, lval);
+                if (consumed >= 0) ((epicsUInt32*)addr.pfield)[nord] = lval;
+                break;
+            case DBF_LONG:
+                consumed = scanValue(format, lval);
+                if (consumed >= 0) ((epicsInt32*)addr.pfield)[nord] = lval;
+                break;
+            case DBF_DOUBLE:
+            {
+                consumed = scanValue(format, dval);
+                epicsFloat64 f64=dval;
+                if (consumed >= 0)
+                    memcpy(((epicsFloat64*)addr.pfield)+nord,
+                        &f64, sizeof(f64));
+                break;
+            }
+        }
+        if (consumed < 0) break;
+        consumedInput += consumed;
+    }
+    debug("Stream::matchArrayField(%s): %s.%s[0...%ld] written directly\n",
+        name(), precord->name, pfldDes->name, nord-1);
+    if (!nord)
+    {
+        // scan error: set other record to alarm status
+        if (precord != record)
+        {
+            (void) recGblSetSevr(precord, CALC_ALARM, INVALID_ALARM);
+            // process other record to send alarm monitor
+            dbProcess(precord);
+            dbScanUnlock(precord);
+        }
+        return 0;
+    }
+    // update NORD and post monitors like dbPut() does
+    if (precord->rset && precord->rset->put_array_info)
+        ((long (*)(DBADDR*, long))precord->rset->put_array_info)
+            (&addr, nord);
+    if (precord->mlis.count &&
+        !(dbIsValueField(pfldDes) && pfldDes->process_passive))
+        db_post_events(precord, addr.pfield, DBE_VALUE | DBE_LOG);
+    if (precord != record)
+    {
+        // process other record like dbPutField() does
+        if (pfldDes->process_passive && precord->scan == 0)
+        {
+            if (precord->pact)
+            {
+                // process again when done
+                precord->rpro = true;
+            }
+            else
+            {
+                precord->putf = true;
+                dbProcess(precord);
+            }
+        }
+        dbScanUnlock(precord);
+    }
+    return 1;
+}
+
+bool Stream::
+matchFinishHook(bool matches)
+{
+    // Write the values collected by matchValue() to the other records.
+    // Lock and process each record only once, like dbPutField() would do
+    // for each value. Like in matchValue(), a failed write stops writing
+    // and fails the input.
+    Redirect r;
+    size_t i, j, next;
+    dbCommon* precord;
+    long status;
+
+    for (i = 0; matches && i < redirects.length(); i = next)
+    {
+        memcpy(&r, redirects(i), sizeof(r));
+        next = i + sizeof(r) + r.size;
+        precord = r.addr.precord;
+        if (!precord) continue; // already written
+        bool process = false;
+        dbScanLock(precord);
+        for (j = i; j < redirects.length(); j += sizeof(r) + r.size)
+        {
+            memcpy(&r, redirects(j), sizeof(r));
+            if (r.addr.precord != precord) continue;
+            // copy value to get proper alignment
+            StreamBuffer value(redirects(j + sizeof(r)), r.size);
+            status = dbPut(&r.addr, r.type, value(), r.nord);
+            debug("Stream::matchFinishHook(%s): dbPut(%s.%s, %s, %s) status=0x%lx\n",
+                name(), precord->name,
+                ((dbFldDes*)r.addr.pfldDes)->name,
+                pamapdbfType[r.type].strvalue,
+                value.expand()(), status);
+            if (status != 0)
+            {
+                error("%s: dbPut(%s.%s, %s, %ld) failed\n",
+                    name(), precord->name,
+                    ((dbFldDes*)r.addr.pfldDes)->name,
+                    pamapdbfType[r.type].strvalue, r.nord);
+                matches = false;
+                break;
+            }
+            else if (r.addr.pfield == &precord->proc ||
+                (((dbFldDes*)r.addr.pfldDes)->process_passive &&
+                precord->scan == 0))
+            {
+                process = true;
+            }
+            r.addr.precord = NULL;
+            memcpy(redirects(j), &r, sizeof(r));
+        }
+        if (process)
+        {
+            if (precord->pact)
+            {
+                // process again when done
+                precord->rpro = true;
+            }
+            else
+            {
+                precord->putf = true;
+                dbProcess(precord);
+            }
+        }
+        dbScanUnlock(precord);
+    }
+    redirects.clear();
+    return matches;
+}
+
 void Stream::
 executeCommand()
 {
@@ -1532,3 +3007,50 @@ releaseMutex()
 {
     mutex.unlock();
 }
+
+static epicsMutex errorGroupLock;
+
+void Stream::
+startErrorTimer(double delay)
+{
+    streamErrorTimer.start(this, delay);
+}
+
+void StreamErrorTimer::
+start(Stream* _stream, double delay)
+{
+    lock.lock();
+    if (!timer)
+    {
+        timerQueue = &epicsTimerQueueActive::allocate(true);
+        timer = &timerQueue->createTimer();
+    }
+    stream = _stream;
+    // do not delay a summary that is due earlier
+    if (timer->getExpireDelay() > delay)
+        timer->start(*this, delay);
+    lock.unlock();
+}
+
+epicsTimerNotify::expireStatus StreamErrorTimer::
+expire(const epicsTime&)
+{
+    lock.lock();
+    Stream* s = stream;
+    lock.unlock();
+    // may call start() again for the next summary
+    if (s) s->flushErrorSummaries();
+    return noRestart;
+}
+
+void Stream::
+lockErrorGroups()
+{
+    errorGroupLock.lock();
+}
+
+void Stream::
+releaseErrorGroups()
+{
+    errorGroupLock.unlock();
+}
@@ -21,6 +21,7 @@
 *************************************************************************/
 
 #include <string.h>
+#include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
 
@@ -40,6 +41,9 @@ FILE *StreamDebugFile = NULL;
 /*0: disable timestamps on stream messages (both debug and error)*/
 int streamMsgTimeStamped = 1;
 
+/*1: write messages in a separate thread (if supported)*/
+int streamAsyncLog = 0;
+
 #ifndef va_copy
 #ifdef __va_copy
 #define va_copy __va_copy
@@ -100,6 +104,50 @@ static void printTimestamp(char* buffer, size_t size)
 
 void (*StreamPrintTimestampFunction)(char* buffer, size_t size) = printTimestamp;
 const char* (*StreamGetThreadNameFunction)(void) = NULL;
+bool (*StreamQueueMessageFunction)(StreamLogTarget target,
+    const char* message, size_t length) = NULL;
+
+#ifdef va_copy
+/* Format the complete message and pass it to the logging thread.
+   Returns false if the message must be written directly.
+*/
+static bool queueMessage(StreamLogTarget target, const char* prefix,
+    const char* fmt, va_list args, const char* suffix)
+{
+    char buffer[1024];
+    char* message = buffer;
+    size_t plen = strlen(prefix);
+    size_t slen = strlen(suffix);
+    int len;
+    bool queued;
+    va_list args2;
+
+    if (plen + slen >= sizeof(buffer)) return false;
+    va_copy(args2, args);
+    len = vsnprintf(buffer + plen, sizeof(buffer) - plen - slen, fmt, args2);
+    va_end(args2);
+    if (len < 0) return false;
+    if (plen + len + slen >= sizeof(buffer))
+    {
+        /* too long for the buffer on the stack */
+        message = (char*)malloc(plen + len + slen + 1);
+        if (!message) return false;
+        va_copy(args2, args);
+        vsnprintf(message + plen, len + 1, fmt, args2);
+        va_end(args2);
+    }
+    memcpy(message, prefix, plen);
+    memcpy(message + plen + len, suffix, slen + 1);
+    queued = StreamQueueMessageFunction(target, message, plen + len + slen);
+    if (message != buffer) free(message);
+    return queued;
+}
+
+static bool asyncLog()
+{
+    return streamAsyncLog && StreamQueueMessageFunction;
+}
+#endif
 
 void StreamError(const char* fmt, ...)
 {
@@ -131,8 +179,33 @@ void StreamVError(int line, const char* file, const char* fmt, va_list args)
     {
         threadname = StreamGetThreadNameFunction();
     }
+    bool stderrQueued = false;
 #ifdef va_copy
-    if (StreamDebugFile)
+    bool fileQueued = false;
+    if (asyncLog())
+    {
+        char prefix[200];
+        size_t n;
+        snprintf(prefix, sizeof(prefix), "%s%s%s%s",
+            timeStamped ? timestamp : "", timeStamped ? " " : "",
+            threadname ? threadname : "", threadname ? " " : "");
+        if (StreamDebugFile)
+            fileQueued = queueMessage(StreamLogFile, prefix, fmt, args, "");
+        snprintf(prefix, sizeof(prefix), "%s%s%s%s%s",
+            ansiEscape(ANSI_RED_BOLD),
+            timeStamped ? timestamp : "", timeStamped ? " " : "",
+            threadname ? threadname : "", threadname ? " " : "");
+        if (file)
+        {
+            n = strlen(prefix);
+            snprintf(prefix + n, sizeof(prefix) - n, "%s line %d: ",
+                file, line);
+        }
+        stderrQueued = queueMessage(StreamLogStderr, prefix, fmt, args,
+            ansiEscape(ANSI_RESET));
+    }
+    /* write directly only where queuing failed */
+    if (StreamDebugFile && !fileQueued)
     {
         va_list args2;
         va_copy(args2, args);
@@ -149,6 +222,7 @@ void StreamVError(int line, const char* file, const char* fmt, va_list args)
         va_end(args2);
     }
 #endif
+    if (stderrQueued) return;
     fprintf(stderr, "%s", ansiEscape(ANSI_RED_BOLD));
     if (timeStamped)
     {
@@ -171,6 +245,38 @@ print(const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
+#ifdef va_copy
+    if (asyncLog())
+    {
+        char prefix[200];
+        size_t n = 0;
+        prefix[0] = 0;
+        if (streamMsgTimeStamped)
+        {
+            StreamPrintTimestampFunction(prefix, sizeof(prefix) - 1);
+            n = strlen(prefix);
+            prefix[n++] = ' ';
+            prefix[n] = 0;
+        }
+        if (StreamGetThreadNameFunction)
+        {
+            snprintf(prefix + n, sizeof(prefix) - n, "%s ",
+                StreamGetThreadNameFunction());
+            n = strlen(prefix);
+        }
+        if (file) {
+            const char* f = strrchr(file, '/');
+            if (f) f++; else f = file;
+            if (line) snprintf(prefix + n, sizeof(prefix) - n, "%s:%d: ", f, line);
+            else snprintf(prefix + n, sizeof(prefix) - n, "%s: ", f);
+        }
+        if (queueMessage(StreamLogDebug, prefix, fmt, args, ""))
+        {
+            va_end(args);
+            return 1;
+        }
+    }
+#endif
     FILE* fp = StreamDebugFile ? StreamDebugFile : stderr;
     if (streamMsgTimeStamped)
     {
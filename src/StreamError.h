@@ -34,9 +34,22 @@ extern int streamDebug;
 extern int streamError;
 extern int streamDebugColored;
 extern int streamMsgTimeStamped;
+extern int streamAsyncLog;
 extern void (*StreamPrintTimestampFunction)(char* buffer, size_t size);
 extern const char* (*StreamGetThreadNameFunction)(void);
 
+/* Where a queued message goes: stderr, StreamDebugFile (if any),
+   or StreamDebugFile if set and stderr otherwise.
+*/
+enum StreamLogTarget { StreamLogStderr, StreamLogFile, StreamLogDebug };
+
+/* If streamAsyncLog is set, complete messages are passed to this
+   function (if installed) to be written by a logging thread.
+   It returns false if the message must be written directly.
+*/
+extern bool (*StreamQueueMessageFunction)(StreamLogTarget target,
+    const char* message, size_t length);
+
 void StreamError(int line, const char* file, const char* fmt, ...)
 __attribute__((__format__(__printf__,3,4)));
 
@@ -29,6 +29,11 @@
 
 #define esc (0x1b)
 
+extern int streamConverterStats;
+
+// CPU time stamp counter cycles or monotonic nanoseconds
+typedef unsigned long long StreamTicks;
+
 template <class C>
 class StreamFormatConverterRegistrar
 {
@@ -49,6 +54,11 @@ public:
     const char* name() { return _name; }
     void provides(const char* name, const char* provided);
     static StreamFormatConverter* find(unsigned char c);
+    static StreamTicks ticks();
+    static void count(unsigned char c, bool scan, ssize_t bytes,
+        StreamTicks start);
+    static void printStatistics(StreamBuffer& output);
+    static void resetStatistics();
     virtual int parse(const StreamFormat& fmt,
         StreamBuffer& info, const char*& source, bool scanFormat) = 0;
     virtual bool printLong(const StreamFormat& fmt,
@@ -67,6 +77,29 @@ public:
         const char* input, char* value, size_t& size);
     virtual ssize_t scanPseudo(const StreamFormat& fmt,
         StreamBuffer& inputLine, size_t& cursor);
+    virtual bool printLongArray(const StreamFormat& fmt,
+        StreamBuffer& output, const long* values, size_t count);
+    virtual ssize_t scanLongArray(const StreamFormat& fmt,
+        const char* input, size_t length, long* values, size_t& count);
+};
+
+// Counts one converter call for streamConverterStats:
+//   StreamConverterTimer stats(fmt.conv, scan);
+//   ...convert...
+//   stats.count(bytes); // bytes < 0: failed
+
+class StreamConverterTimer
+{
+    unsigned char conv;
+    bool scan;
+    StreamTicks start;
+public:
+    StreamConverterTimer(unsigned char conv, bool scan)
+        : conv(conv), scan(scan),
+        start(streamConverterStats ? StreamFormatConverter::ticks() : 0) {}
+    void count(ssize_t bytes) {
+        if (start) StreamFormatConverter::count(conv, scan, bytes, start);
+    }
 };
 
 inline StreamFormatConverter* StreamFormatConverter::
@@ -151,6 +184,19 @@ void* ref_##converter = &registrar_##converter\
 * to update size.
 * Return -1 on failure.
 *
+* printLongArray(), scanLongArray()
+* =================
+* Arrays of long values without separator are passed to the converter
+* as a whole. The default implementations call printLong() or scanLong()
+* for each element. Override them if the conversion can be done faster
+* for many values at once.
+* In scanLongArray(), length is the number of input bytes available.
+* Scan at most count values and update count with the number of values
+* actually scanned. Stop at the first element that fails, that would
+* exceed length, or that does not consume exactly fmt.width bytes if
+* the fix_width_flag is set.
+* Return the number of consumed bytes.
+*
 *
 * Register your class
 * ===================
@@ -0,0 +1,152 @@
+/*************************************************************************
+* This is a timer wheel used in StreamDevice for protocol timeouts.
+* Please see ../docs/ for detailed documentation.
+*
+* (C) 2026 Dirk Zimoch (dirk.zimoch@psi.ch)
+*
+* This file is part of StreamDevice.
+*
+* StreamDevice is free software: You can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published
+* by the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* StreamDevice is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with StreamDevice. If not, see https://www.gnu.org/licenses/.
+*************************************************************************/
+
+#include <string.h>
+#include "StreamTimerWheel.h"
+
+int streamTimerWheel = 0;
+
+StreamTimerWheel::
+StreamTimerWheel(unsigned long now)
+    : due(NULL), current(now), count(0)
+{
+    memset(slots, 0, sizeof(slots));
+}
+
+void StreamTimerWheel::
+insert(Timer*& head, Timer& timer)
+{
+    timer.next = head;
+    if (head) head->pprev = &timer.next;
+    head = &timer;
+    timer.pprev = &head;
+}
+
+void StreamTimerWheel::
+unlink(Timer& timer)
+{
+    *timer.pprev = timer.next;
+    if (timer.next) timer.next->pprev = timer.pprev;
+    timer.next = NULL;
+    timer.pprev = NULL;
+}
+
+void StreamTimerWheel::
+place(Timer& timer)
+{
+    unsigned long delta = timer.expires - current;
+    int level;
+
+    // already due: next tick
+    if ((long)delta < 0) delta = 0;
+    for (level = 0; level < Levels - 1; level++)
+    {
+        if (delta < 1UL << (SlotBits * (level + 1))) break;
+    }
+    // too far ahead: park in last slot, moved down again later
+    if (delta >= 1UL << (SlotBits * Levels))
+        delta = (1UL << (SlotBits * Levels)) - 1;
+    insert(slots[level][((current + delta) >> (SlotBits * level)) & SlotMask],
+        timer);
+}
+
+void StreamTimerWheel::
+cascade(int level, unsigned long tick)
+{
+    Timer*& slot = slots[level][(tick >> (SlotBits * level)) & SlotMask];
+    Timer* list = slot;
+    slot = NULL;
+    while (list)
+    {
+        Timer* timer = list;
+        list = timer->next;
+        timer->next = NULL;
+        place(*timer);
+    }
+}
+
+void StreamTimerWheel::
+start(Timer& timer, unsigned long expires)
+{
+    if (timer.pending()) unlink(timer);
+    else count++;
+    timer.expires = expires;
+    place(timer);
+}
+
+void StreamTimerWheel::
+cancel(Timer& timer)
+{
+    if (!timer.pending()) return;
+    unlink(timer);
+    count--;
+}
+
+StreamTimerWheel::Timer* StreamTimerWheel::
+expired(unsigned long now)
+{
+    while (!due)
+    {
+        if ((long)(now - current) < 0) return NULL;
+        if (!count)
+        {
+            // nothing to move down
+            current = now + 1;
+            return NULL;
+        }
+        unsigned long tick = current;
+        for (int level = 1; level < Levels; level++)
+        {
+            if (tick & ((1UL << (SlotBits * level)) - 1)) break;
+            cascade(level, tick);
+        }
+        Timer*& slot = slots[0][tick & SlotMask];
+        if (slot)
+        {
+            // timers started by expire() must not go into this list
+            due = slot;
+            due->pprev = &due;
+            slot = NULL;
+        }
+        current = tick + 1;
+    }
+    Timer* timer = due;
+    unlink(*timer);
+    count--;
+    return timer;
+}
+
+unsigned long StreamTimerWheel::
+nextTimeout(unsigned long now, unsigned long limit) const
+{
+    unsigned long tick;
+
+    if (due) return 0;
+    if (!count) return limit;
+    for (tick = current; tick != current + Slots; tick++)
+    {
+        // look ahead in level 0 up to the next move down from level 1
+        if (!(tick & SlotMask) || slots[0][tick & SlotMask]) break;
+    }
+    if ((long)(tick - now) <= 0) return 0;
+    return tick - now;
+}
@@ -0,0 +1,101 @@
+/*************************************************************************
+* This is a timer wheel used in StreamDevice for protocol timeouts.
+* Please see ../docs/ for detailed documentation.
+*
+* (C) 2026 Dirk Zimoch (dirk.zimoch@psi.ch)
+*
+* This file is part of StreamDevice.
+*
+* StreamDevice is free software: You can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published
+* by the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* StreamDevice is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with StreamDevice. If not, see https://www.gnu.org/licenses/.
+*************************************************************************/
+
+#ifndef StreamTimerWheel_h
+#define StreamTimerWheel_h
+
+#include <stddef.h>
+
+// Use one timer wheel per port instead of one epicsTimer per record (0: off)
+extern int streamTimerWheel;
+
+// Hierarchical timer wheel with 4 levels of 64 slots, one tick per ms.
+// Starting and cancelling a timer is O(1). Timers more than 64^4 ticks
+// (about 4.6 hours) ahead are parked in the last level and moved down
+// again when their slot comes up.
+// The wheel is not locked and does not read any clock: the caller
+// passes the current tick and calls expired() until it returns NULL.
+
+class StreamTimerWheel
+{
+public:
+    class Timer
+    {
+        friend class StreamTimerWheel;
+        Timer* next;
+        Timer** pprev;            // NULL: not pending
+        unsigned long expires;    // tick, wraps around
+    public:
+        Timer() : next(NULL), pprev(NULL), expires(0) {}
+        virtual ~Timer() {}
+        virtual void expire() = 0;
+        bool pending() const { return pprev != NULL; }
+    };
+
+    StreamTimerWheel(unsigned long now);
+    // (re-)start timer to expire at tick 'expires'
+    void start(Timer& timer, unsigned long expires);
+    void cancel(Timer& timer);
+    // next timer due at tick 'now' (already removed from the wheel)
+    Timer* expired(unsigned long now);
+    // ticks after 'now' until expired() may return a timer again
+    // (limit: nothing pending)
+    unsigned long nextTimeout(unsigned long now, unsigned long limit) const;
+    size_t pending() const { return count; }
+
+private:
+    enum { Levels = 4, SlotBits = 6, Slots = 1 << SlotBits,
+        SlotMask = Slots - 1 };
+    Timer* slots[Levels][Slots];
+    Timer* due;                   // taken from slot, not yet returned
+    unsigned long current;        // next tick to process
+    size_t count;
+
+    void insert(Timer*& head, Timer& timer);
+    static void unlink(Timer& timer);
+    void place(Timer& timer);
+    void cascade(int level, unsigned long tick);
+    StreamTimerWheel(const StreamTimerWheel&); // undefined
+};
+
+// Timer on the wheel shared by all records of one asyn port, with the
+// semantics of epicsTimer: start() re-arms, cancel() waits for a running
+// expire(). Implemented in StreamEpics.cc with one thread per port.
+
+class epicsTimerNotify;
+
+class StreamPortTimer : StreamTimerWheel::Timer
+{
+    class Thread;
+    friend class Thread;
+    Thread* thread;
+    epicsTimerNotify& notify;
+    void expire();
+public:
+    StreamPortTimer(const char* portname, epicsTimerNotify& notify);
+    ~StreamPortTimer();
+    void start(double delay);
+    void cancel();
+    bool valid() const { return thread != NULL; }
+};
+
+#endif
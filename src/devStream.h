@@ -97,6 +97,13 @@ long streamGetIointInfo(int cmd,
 long streamPrintf(dbCommon *record, format_t *format, ...);
 ssize_t streamScanfN(dbCommon *record, format_t *format,
     void*, size_t maxStringSize);
+long streamPrintfArray(dbCommon *record, format_t *format,
+    const void* values, unsigned short ftvl, size_t count);
+ssize_t streamScanfArray(dbCommon *record, format_t *format,
+    void* values, unsigned short ftvl, size_t maxElements);
+void* streamShadowBuffer(dbCommon *record, size_t size);
+void streamSwapBuffer(dbCommon *record, void** bptr,
+    epicsUInt32* nord, epicsUInt32 count);
 
 #ifdef __cplusplus
 }
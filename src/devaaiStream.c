@@ -23,108 +23,52 @@
 #include "aaiRecord.h"
 #include "devStream.h"
 
-static long readData(dbCommon *record, format_t *format)
+static long scanData(dbCommon *record, format_t *format,
+    void *bptr, epicsUInt32 *pnord)
 {
     aaiRecord *aai = (aaiRecord *)record;
-    double dval;
-    long lval;
+    epicsUInt32 nord;
 
-    for (aai->nord = 0; aai->nord < aai->nelm; aai->nord++)
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are scanned at once */
+        ssize_t count = streamScanfArray(record, format,
+            bptr, aai->ftvl, aai->nelm);
+        *pnord = count > 0 ? (epicsUInt32)count : 0;
+        return *pnord ? OK : ERROR;
+    }
+    for (nord = 0; nord < aai->nelm; nord++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                if (streamScanf(record, format, &dval) == ERROR)
-                {
-                    return aai->nord ? OK : ERROR;
-                }
-                switch (aai->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)aai->bptr)[aai->nord] = (epicsFloat64)dval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)aai->bptr)[aai->nord] = (epicsFloat32)dval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from double to %s\n",
-                            record->name, pamapdbfType[aai->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
-            case DBF_ULONG:
-            case DBF_LONG:
-            case DBF_ENUM:
-            {
-                if (streamScanf(record, format, &lval) == ERROR)
-                {
-                    return aai->nord ? OK : ERROR;
-                }
-                switch (aai->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)aai->bptr)[aai->nord] = (epicsFloat64)lval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)aai->bptr)[aai->nord] = (epicsFloat32)lval;
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                    case DBF_UINT64:
-                        ((epicsInt64 *)aai->bptr)[aai->nord] = (epicsInt64)lval;
-                        break;
-#endif
-                    case DBF_LONG:
-                    case DBF_ULONG:
-                        ((epicsInt32 *)aai->bptr)[aai->nord] = (epicsInt32)lval;
-                        break;
-                    case DBF_SHORT:
-                    case DBF_USHORT:
-                    case DBF_ENUM:
-                        ((epicsInt16 *)aai->bptr)[aai->nord] = (epicsInt16)lval;
-                        break;
-                    case DBF_CHAR:
-                    case DBF_UCHAR:
-                        ((epicsInt8 *)aai->bptr)[aai->nord] = (epicsInt8)lval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from long to %s\n",
-                            record->name, pamapdbfType[aai->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
             case DBF_STRING:
             {
                 switch (aai->ftvl)
                 {
                     case DBF_STRING:
                         if (streamScanfN(record, format,
-                            (char *)aai->bptr + aai->nord * MAX_STRING_SIZE,
+                            (char *)bptr + nord * MAX_STRING_SIZE,
                             MAX_STRING_SIZE) == ERROR)
                         {
-                            return aai->nord ? OK : ERROR;
+                            *pnord = nord;
+                            return nord ? OK : ERROR;
                         }
                         break;
                     case DBF_CHAR:
                     case DBF_UCHAR:
                     {
                         ssize_t length;
-                        aai->nord = 0;
                         if ((length = streamScanfN(record, format,
-                            (char *)aai->bptr, aai->nelm)) == ERROR)
+                            (char *)bptr, aai->nelm)) == ERROR)
                         {
                             return ERROR;
                         }
                         if (length < (ssize_t)aai->nelm)
                         {
-                            ((char*)aai->bptr)[length] = 0;
+                            ((char*)bptr)[length] = 0;
                         }
-                        aai->nord = (long)length;
+                        *pnord = (epicsUInt32)length;
                         return OK;
                     }
                     default:
@@ -145,110 +89,51 @@ static long readData(dbCommon *record, format_t *format)
             }
         }
     }
+    *pnord = nord;
     return OK;
 }
 
+static long readData(dbCommon *record, format_t *format)
+{
+    aaiRecord *aai = (aaiRecord *)record;
+    epicsUInt32 nord = 0;
+    void *buffer;
+    long status;
+
+    /* In double buffer mode parse into a shadow buffer and swap it
+       with bptr only on success. Thus a failed parse does not leave
+       a half updated array and clients see the previous array until
+       the new one is complete. */
+    buffer = streamShadowBuffer(record, aai->nelm * dbValueSize(aai->ftvl));
+    if (!buffer) buffer = aai->bptr;
+    status = scanData(record, format, buffer, &nord);
+    if (buffer != aai->bptr)
+    {
+        /* bptr and nord change when the record is processed */
+        if (status == OK)
+            streamSwapBuffer(record, &aai->bptr, &aai->nord, nord);
+        return status;
+    }
+    aai->nord = nord;
+    return status;
+}
+
 static long writeData(dbCommon *record, format_t *format)
 {
     aaiRecord *aai = (aaiRecord *)record;
-    double dval;
-    long lval;
     unsigned long nowd;
 
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are printed at once */
+        return streamPrintfArray(record, format,
+            aai->bptr, aai->ftvl, aai->nord);
+    }
     for (nowd = 0; nowd < aai->nord; nowd++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                switch (aai->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        dval = ((epicsFloat64 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_FLOAT:
-                        dval = ((epicsFloat32 *)aai->bptr)[nowd];
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        dval = (double)((epicsInt64 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        dval = (double)((epicsUInt64 *)aai->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        dval = ((epicsInt32 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        dval = ((epicsUInt32 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        dval = ((epicsInt16 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        dval = ((epicsUInt16 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        dval = ((epicsInt8 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        dval = ((epicsUInt8 *)aai->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to double\n",
-                            record->name, pamapdbfType[aai->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, dval))
-                    return ERROR;
-                break;
-            }
-            case DBF_ULONG:
-            case DBF_LONG:
-            case DBF_ENUM:
-            {
-                switch (aai->ftvl)
-                {
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        lval = (long)((epicsInt64 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        lval = (long)((epicsUInt64 *)aai->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        lval = ((epicsInt32 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        lval = ((epicsUInt32 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        lval = ((epicsInt16 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        lval = ((epicsUInt16 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        lval = ((epicsInt8 *)aai->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        lval = ((epicsUInt8 *)aai->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to long\n",
-                            record->name, pamapdbfType[aai->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, lval))
-                    return ERROR;
-                break;
-            }
             case DBF_STRING:
             {
                 switch (aai->ftvl)
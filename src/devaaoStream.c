@@ -27,75 +27,21 @@
 static long readData(dbCommon *record, format_t *format)
 {
     aaoRecord *aao = (aaoRecord *)record;
-    double dval;
-    long lval;
     unsigned short monitor_mask;
 
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are scanned at once */
+        ssize_t count = streamScanfArray(record, format,
+            aao->bptr, aao->ftvl, aao->nelm);
+        aao->nord = count > 0 ? (long)count : 0;
+        goto end;
+    }
     for (aao->nord = 0; aao->nord < aao->nelm; aao->nord++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                if (streamScanf(record, format, &dval) == ERROR)
-                    goto end;
-                switch (aao->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)aao->bptr)[aao->nord] = (epicsFloat64)dval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)aao->bptr)[aao->nord] = (epicsFloat32)dval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from double to %s\n",
-                            record->name, pamapdbfType[aao->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
-            case DBF_ULONG:
-            case DBF_LONG:
-            case DBF_ENUM:
-            {
-                if (streamScanf(record, format, &lval) == ERROR)
-                    goto end;
-                switch (aao->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)aao->bptr)[aao->nord] = (epicsFloat64)lval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)aao->bptr)[aao->nord] = (epicsFloat32)lval;
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                    case DBF_UINT64:
-                        ((epicsInt64 *)aao->bptr)[aao->nord] = (epicsInt64)lval;
-                        break;
-#endif
-                    case DBF_LONG:
-                    case DBF_ULONG:
-                        ((epicsInt32 *)aao->bptr)[aao->nord] = (epicsInt32)lval;
-                        break;
-                    case DBF_SHORT:
-                    case DBF_USHORT:
-                    case DBF_ENUM:
-                        ((epicsInt16 *)aao->bptr)[aao->nord] = (epicsInt16)lval;
-                        break;
-                    case DBF_CHAR:
-                    case DBF_UCHAR:
-                        ((epicsInt8 *)aao->bptr)[aao->nord] = (epicsInt8)lval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from long to %s\n",
-                            record->name, pamapdbfType[aao->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
             case DBF_STRING:
             {
                 switch (aao->ftvl)
@@ -179,104 +125,19 @@ end_no_check:
 static long writeData(dbCommon *record, format_t *format)
 {
     aaoRecord *aao = (aaoRecord *)record;
-    double dval;
-    long lval;
     unsigned long nowd;
 
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are printed at once */
+        return streamPrintfArray(record, format,
+            aao->bptr, aao->ftvl, aao->nord);
+    }
     for (nowd = 0; nowd < aao->nord; nowd++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                switch (aao->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        dval = ((epicsFloat64 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_FLOAT:
-                        dval = ((epicsFloat32 *)aao->bptr)[nowd];
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        dval = (double)((epicsInt64 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        dval = (double)((epicsUInt64 *)aao->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        dval = ((epicsInt32 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        dval = ((epicsUInt32 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        dval = ((epicsInt16 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        dval = ((epicsUInt16 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        dval = ((epicsInt8 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        dval = ((epicsUInt8 *)aao->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to double\n",
-                            record->name, pamapdbfType[aao->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, dval))
-                    return ERROR;
-                break;
-            }
-            case DBF_ULONG:
-            case DBF_LONG:
-            case DBF_ENUM:
-            {
-                switch (aao->ftvl)
-                {
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        lval = (long)((epicsInt64 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        lval = (long)((epicsUInt64 *)aao->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        lval = ((epicsInt32 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        lval = ((epicsUInt32 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        lval = ((epicsInt16 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        lval = ((epicsUInt16 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        lval = ((epicsInt8 *)aao->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        lval = ((epicsUInt8 *)aao->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to long\n",
-                            record->name, pamapdbfType[aao->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, lval))
-                    return ERROR;
-                break;
-            }
             case DBF_STRING:
             {
                 switch (aao->ftvl)
@@ -23,109 +23,52 @@
 #include "waveformRecord.h"
 #include "devStream.h"
 
-static long readData(dbCommon *record, format_t *format)
+static long scanData(dbCommon *record, format_t *format,
+    void *bptr, epicsUInt32 *pnord)
 {
     waveformRecord *wf = (waveformRecord *)record;
-    double dval;
-    long lval;
+    epicsUInt32 nord;
 
-    wf->rarm = 0;
-    for (wf->nord = 0; wf->nord < wf->nelm; wf->nord++)
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are scanned at once */
+        ssize_t count = streamScanfArray(record, format,
+            bptr, wf->ftvl, wf->nelm);
+        *pnord = count > 0 ? (epicsUInt32)count : 0;
+        return *pnord ? OK : ERROR;
+    }
+    for (nord = 0; nord < wf->nelm; nord++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                if (streamScanf(record, format, &dval) == ERROR)
-                {
-                    return wf->nord ? OK : ERROR;
-                }
-                switch (wf->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)wf->bptr)[wf->nord] = (epicsFloat64)dval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)wf->bptr)[wf->nord] = (epicsFloat32)dval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from double to %s\n",
-                            record->name, pamapdbfType[wf->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
-            case DBF_ULONG:
-            case DBF_LONG:
-            case DBF_ENUM:
-            {
-                if (streamScanf(record, format, &lval) == ERROR)
-                {
-                    return wf->nord ? OK : ERROR;
-                }
-                switch (wf->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        ((epicsFloat64 *)wf->bptr)[wf->nord] = (epicsFloat64)lval;
-                        break;
-                    case DBF_FLOAT:
-                        ((epicsFloat32 *)wf->bptr)[wf->nord] = (epicsFloat32)lval;
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                    case DBF_UINT64:
-                        ((epicsInt64 *)wf->bptr)[wf->nord] = (epicsInt64)lval;
-                        break;
-#endif
-                    case DBF_LONG:
-                    case DBF_ULONG:
-                        ((epicsInt32 *)wf->bptr)[wf->nord] = (epicsInt32)lval;
-                        break;
-                    case DBF_SHORT:
-                    case DBF_USHORT:
-                    case DBF_ENUM:
-                        ((epicsInt16 *)wf->bptr)[wf->nord] = (epicsInt16)lval;
-                        break;
-                    case DBF_CHAR:
-                    case DBF_UCHAR:
-                        ((epicsInt8 *)wf->bptr)[wf->nord] = (epicsInt8)lval;
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "readData %s: can't convert from long to %s\n",
-                            record->name, pamapdbfType[wf->ftvl].strvalue);
-                        return ERROR;
-                }
-                break;
-            }
             case DBF_STRING:
             {
                 switch (wf->ftvl)
                 {
                     case DBF_STRING:
                         if (streamScanfN(record, format,
-                            (char *)wf->bptr + wf->nord * MAX_STRING_SIZE,
+                            (char *)bptr + nord * MAX_STRING_SIZE,
                             MAX_STRING_SIZE) == ERROR)
                         {
-                            return wf->nord ? OK : ERROR;
+                            *pnord = nord;
+                            return nord ? OK : ERROR;
                         }
                         break;
                     case DBF_CHAR:
                     case DBF_UCHAR:
                     {
                         ssize_t length;
-                        wf->nord = 0;
                         if ((length = streamScanfN(record, format,
-                            (char *)wf->bptr, wf->nelm)) == ERROR)
+                            (char *)bptr, wf->nelm)) == ERROR)
                         {
                             return ERROR;
                         }
                         if (length < (ssize_t)wf->nelm)
                         {
-                            ((char*)wf->bptr)[length] = 0;
+                            ((char*)bptr)[length] = 0;
                         }
-                        wf->nord = (long)length;
+                        *pnord = (epicsUInt32)length;
                         return OK;
                     }
                     default:
@@ -146,110 +89,52 @@ static long readData(dbCommon *record, format_t *format)
             }
         }
     }
+    *pnord = nord;
     return OK;
 }
 
+static long readData(dbCommon *record, format_t *format)
+{
+    waveformRecord *wf = (waveformRecord *)record;
+    epicsUInt32 nord = 0;
+    void *buffer;
+    long status;
+
+    wf->rarm = 0;
+    /* In double buffer mode parse into a shadow buffer and swap it
+       with bptr only on success. Thus a failed parse does not leave
+       a half updated array and clients see the previous array until
+       the new one is complete. */
+    buffer = streamShadowBuffer(record, wf->nelm * dbValueSize(wf->ftvl));
+    if (!buffer) buffer = wf->bptr;
+    status = scanData(record, format, buffer, &nord);
+    if (buffer != wf->bptr)
+    {
+        /* bptr and nord change when the record is processed */
+        if (status == OK)
+            streamSwapBuffer(record, &wf->bptr, &wf->nord, nord);
+        return status;
+    }
+    wf->nord = nord;
+    return status;
+}
+
 static long writeData(dbCommon *record, format_t *format)
 {
     waveformRecord *wf = (waveformRecord *)record;
-    double dval;
-    long lval;
     unsigned long nowd;
 
+    if (format->type == DBF_ULONG || format->type == DBF_LONG ||
+        format->type == DBF_ENUM || format->type == DBF_DOUBLE)
+    {
+        /* numeric arrays are printed at once */
+        return streamPrintfArray(record, format,
+            wf->bptr, wf->ftvl, wf->nord);
+    }
     for (nowd = 0; nowd < wf->nord; nowd++)
     {
         switch (format->type)
         {
-            case DBF_DOUBLE:
-            {
-                switch (wf->ftvl)
-                {
-                    case DBF_DOUBLE:
-                        dval = ((epicsFloat64 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_FLOAT:
-                        dval = ((epicsFloat32 *)wf->bptr)[nowd];
-                        break;
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        dval = (double)((epicsInt64 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        dval = (double)((epicsUInt64 *)wf->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        dval = ((epicsInt32 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        dval = ((epicsUInt32 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        dval = ((epicsInt16 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        dval = ((epicsUInt16 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        dval = ((epicsInt8 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        dval = ((epicsUInt8 *)wf->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to double\n",
-                            record->name, pamapdbfType[wf->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, dval))
-                    return ERROR;
-                break;
-            }
-            case DBF_LONG:
-            case DBF_ULONG:
-            case DBF_ENUM:
-            {
-                switch (wf->ftvl)
-                {
-#ifdef DBR_INT64
-                    case DBF_INT64:
-                        lval = (long)((epicsInt64 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_UINT64:
-                        lval = (long)((epicsUInt64 *)wf->bptr)[nowd];
-                        break;
-#endif
-                    case DBF_LONG:
-                        lval = ((epicsInt32 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_ULONG:
-                        lval = ((epicsUInt32 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_SHORT:
-                    case DBF_ENUM:
-                        lval = ((epicsInt16 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_USHORT:
-                        lval = ((epicsUInt16 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_CHAR:
-                        lval = ((epicsInt8 *)wf->bptr)[nowd];
-                        break;
-                    case DBF_UCHAR:
-                        lval = ((epicsUInt8 *)wf->bptr)[nowd];
-                        break;
-                    default:
-                        errlogSevPrintf(errlogFatal,
-                            "writeData %s: can't convert from %s to long\n",
-                            record->name, pamapdbfType[wf->ftvl].strvalue);
-                        return ERROR;
-                }
-                if (streamPrintf(record, format, lval))
-                    return ERROR;
-                break;
-            }
             case DBF_STRING:
             {
                 switch (wf->ftvl)
@@ -34,9 +34,24 @@ if (@ARGV[0] eq "-3.13") {
     print "variable(streamError, int)\n";
     print "variable(streamDebugColored, int)\n";
     print "variable(streamErrorDeadTime, int)\n";
+    print "variable(streamErrorWindow, int)\n";
+    print "variable(streamConverterStats, int)\n";
+    print "variable(streamArrayPrescan, int)\n";
+    print "variable(streamParseThreads, int)\n";
+    print "variable(streamParseThreshold, int)\n";
+    print "variable(streamDoubleBuffer, int)\n";
+    print "variable(streamTraceSize, int)\n";
+    print "variable(streamLatencyStats, int)\n";
+    print "variable(streamTimerWheel, int)\n";
     print "variable(streamMsgTimeStamped, int)\n";
+    print "variable(streamAsyncLog, int)\n";
     print "registrar(streamRegistrar)\n";
-    if ($asyn) { print "registrar(AsynDriverInterfaceRegistrar)\n"; }
+    if ($asyn) {
+        print "registrar(AsynDriverInterfaceRegistrar)\n";
+        print "variable(streamDrainSize, int)\n";
+        print "variable(streamReadSizeLimit, int)\n";
+        print "variable(streamIntrReader, int)\n";
+    }
 }
 print "driver(stream)\n";
 }